@@ -13,12 +13,16 @@
 #include "context.h"
 #include "meta.h"
 #include "ipc.h"
+#include "registry.h"
+#include "timer.h"
 
 typedef struct {
   GApplication* gapp;
   Meta* meta;
   IPC* ipc;
-  GList* contexts;
+  Registry* contexts;
+  TimerWheel* timers;
+  GHashTable* program_paths;
   bool is_isolated;
 } App;
 
@@ -27,6 +31,9 @@ extern App* app;
 void app_init();
 void app_close();
 void app_quit_context(Context* context);
+Context* app_get_context(int id);
+void app_sync_hook_handlers(Context* context);
 int app_start(Option* option, int argc, char **argv);
+int app_perform_remote(Option* option);
 
 #endif
@@ -0,0 +1,30 @@
+/**
+ * arena.h
+ *
+ * Copyright (c) 2026 endaaman
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license. See the LICENSE file for details.
+ */
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include "common.h"
+
+
+typedef struct ArenaChunk ArenaChunk;
+
+typedef struct {
+  ArenaChunk* head;
+  size_t chunk_size;
+} Arena;
+
+
+Arena* arena_init(size_t chunk_size);
+void arena_close(Arena* arena);
+void* arena_alloc(Arena* arena, size_t size);
+char* arena_strdup(Arena* arena, const char* s);
+char* arena_strdup_printf(Arena* arena, const char* fmt, ...) G_GNUC_PRINTF(2, 3);
+
+#endif
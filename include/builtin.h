@@ -11,8 +11,10 @@
 #define BUILTIN_H
 
 #include "common.h"
+#include "context.h"
 
 
 int builtin_register_module(lua_State* L);
+void builtin_detach_tasks(Context* context);
 
 #endif
@@ -11,10 +11,15 @@
 #define CONTEXT_H
 
 #include "common.h"
+#include "arena.h"
 #include "config.h"
 #include "hook.h"
 #include "keymap.h"
+#include "macro.h"
 #include "option.h"
+#include "paste.h"
+#include "stats.h"
+#include "trigger.h"
 
 
 typedef struct {
@@ -27,26 +32,69 @@ typedef struct {
   bool alpha_supported;
 } Layout;
 
-typedef struct {
+typedef struct HandlerTag {
   void* object;
   int handler_id;
+  struct HandlerTag* next;
 } HandlerTag;
 
 typedef struct {
+  double delta_x;
+  double delta_y;
+  double x;
+  double y;
+  bool pending;
+  bool suppressed;
+  unsigned tick_id;
+} ScrollState;
+
+typedef struct {
+  long row;
+  unsigned tag;
+} OutputState;
+
+// Signals which are connected only while a hook needs them
+typedef enum {
+  HOOK_HANDLER_SCROLL,
+  HOOK_HANDLER_SELECTION,
+  HOOK_HANDLER_FOCUS_OUT,
+  HOOK_HANDLER_SIZE_ALLOCATE,
+  HOOK_HANDLER_CONTENTS,
+  HOOK_HANDLER_COUNT,
+} HookHandler;
+
+typedef struct Context {
   int id;
   bool config_loading;
   bool initialized;
   char* object_path;
   int registration_id;
   int child_pid;
-  GList* handler_tags;
+  gint64 spawn_started_at;
+  gint64 spawn_latency;
+  Arena* arena;
+  HandlerTag* handler_tags;
+  HandlerTag hook_handlers[HOOK_HANDLER_COUNT];
   Option* option;
   Config* config;
   Keymap* keymap;
+  Macro* macro;
   Hook* hook;
+  Triggers* triggers;
+  Stats* stats;
+  int lua_timeout;
+  unsigned config_generation;
+  GList* tasks;
   GdkDevice* device;
   lua_State* lua;
   Layout layout;
+  Paste* paste;
+  ScrollState scroll;
+  OutputState output;
+  unsigned selection_tag;
+  struct Context** selection_waiter; // cleared on close while the text is awaited
+  unsigned title_tag;
+  unsigned resize_tick_id;
 } Context;
 
 
@@ -61,6 +109,9 @@ void context_close(Context* context);
 void context_add_handler_tag(Context* context, void* object, int handler_id);
 void context_load_device(Context* context);
 void context_load_lua_context(Context* context);
+Context* context_from_lua(lua_State* L);
+int context_pcall(Context* context, int narg, int nresult);
+int context_resume(Context* context, lua_State* thread, int narg, int* nres);
 void context_log_message(Context* context, bool notify, const char* fmt, ...);
 void context_log_warn(Context* context, bool notify, const char* fmt, ...);
 void context_restore_default(Context* context);
@@ -70,6 +121,8 @@ char* context_acquire_theme_path(Context* context);
 void context_load_config(Context* context);
 void context_load_theme(Context* context);
 bool context_perform_keymap(Context* context, unsigned key, GdkModifierType mod);
+bool context_send_key(Context* context, unsigned key, GdkModifierType mod);
+bool context_play_macro(Context* context, unsigned count);
 void context_handle_signal(Context* context, const char* signal_name, GVariant* parameters);
 void context_build_layout(Context* context);
 void context_notify(Context* context, const char* body, const char* title);
@@ -11,15 +11,35 @@
 #define HOOK_H
 
 #include "common.h"
+#include "stats.h"
 
 
+typedef enum {
+  HOOK_TITLE,
+  HOOK_BELL,
+  HOOK_CLICKED,
+  HOOK_SCROLL,
+  HOOK_DRAG,
+  HOOK_ACTIVATED,
+  HOOK_DEACTIVATED,
+  HOOK_SELECTED,
+  HOOK_UNSELECTED,
+  HOOK_RESIZED,
+  HOOK_SIGNAL,
+  HOOK_OUTPUT,
+  HOOK_COUNT,
+} HookType;
+
 typedef struct {
-  GHashTable* refs;
+  int refs[HOOK_COUNT];
+  Stats* stats;
 } Hook;
 
 
-Hook* hook_init();
+Hook* hook_init(Stats* stats);
 void hook_close(Hook* hook);
+HookType hook_get_type(const char* key);
+bool hook_is_set(Hook* hook, HookType type);
 bool hook_set_ref(Hook* hook, const char* key, int ref, int* old_ref);
 bool hook_perform_title(Hook* hook, lua_State* L, const char* title, bool* result);
 bool hook_perform_bell(Hook* hook, lua_State* L, bool* result);
@@ -30,7 +50,8 @@ bool hook_perform_activated(Hook* hook, lua_State* L);
 bool hook_perform_deactivated(Hook* hook, lua_State* L);
 bool hook_perform_selected(Hook* hook, lua_State* L, const char* text);
 bool hook_perform_unselected(Hook* hook, lua_State* L);
-bool hook_perform_resized(Hook* hook, lua_State* L);
-bool hook_perform_signal(Hook* hook, lua_State* L, const char* param);
+bool hook_perform_resized(Hook* hook, lua_State* L, long columns, long rows, int width, int height);
+bool hook_perform_signal(Hook* hook, lua_State* L, GVariant* params);
+bool hook_perform_output(Hook* hook, lua_State* L, const char* text);
 
 #endif
@@ -14,15 +14,44 @@
 
 
 typedef struct {
-  GList* entries;
+  guint64 chord;
+  char* accelerator;
+  int ref;
+  const void* default_data;
+  GHashTable* children;
+} KeymapNode;
+
+#define TYM_KEYMAP_FILTER_BITS 1024
+
+// Called with the key starting a sequence when the sequence times out
+typedef void (*KeymapExpireFunc)(KeymapNode* node, void* user_data);
+
+typedef struct {
+  guint64 filter[TYM_KEYMAP_FILTER_BITS / 64];
+  KeymapNode* root;
+  KeymapNode* pending;
+  unsigned pending_tag;
+  KeymapExpireFunc expire_func;
+  void* expire_data;
 } Keymap;
 
+typedef enum {
+  KEYMAP_STATUS_NONE,
+  KEYMAP_STATUS_PENDING,
+  KEYMAP_STATUS_MATCHED,
+} KeymapStatus;
+
 
 Keymap* keymap_init();
 void keymap_close(Keymap* keymap);
-void keymap_reset(Keymap* keymap);
-bool keymap_add_entry(Keymap* keymap, const char* accelerator, int ref);
-bool keymap_remove_entry(Keymap* keymap, const char* accelerator);
-bool keymap_perform(Keymap* keymap, lua_State* L, unsigned key, GdkModifierType mod, bool* result, char** error);
+void keymap_reset(Keymap* keymap, lua_State* L);
+void keymap_set_expire_func(Keymap* keymap, KeymapExpireFunc func, void* user_data);
+bool keymap_set_default(Keymap* keymap, unsigned key, GdkModifierType mod, const void* data);
+bool keymap_add_entry(Keymap* keymap, lua_State* L, const char* accelerator, int ref);
+bool keymap_remove_entry(Keymap* keymap, lua_State* L, const char* accelerator);
+bool keymap_may_handle(Keymap* keymap, unsigned key);
+KeymapStatus keymap_feed(Keymap* keymap, unsigned key, GdkModifierType mod, KeymapNode** matched);
+bool keymap_expire(Keymap* keymap, KeymapNode** matched);
+bool keymap_perform(KeymapNode* node, lua_State* L, bool* result, char** error);
 
 #endif
@@ -0,0 +1,47 @@
+/**
+ * macro.h
+ *
+ * Copyright (c) 2026 endaaman
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license. See the LICENSE file for details.
+ */
+
+#ifndef MACRO_H
+#define MACRO_H
+
+#include "common.h"
+
+
+typedef struct {
+  unsigned keyval;
+  unsigned state;
+} MacroKey;
+
+// Where a macro is played to. Keys which are text and not bound go to `feed`
+// in batches, and the others to `send` one by one.
+typedef struct {
+  bool (*is_bound)(const MacroKey* key, void* user_data);
+  void (*feed)(const char* text, size_t length, void* user_data);
+  void (*send)(const MacroKey* key, void* user_data);
+} MacroSink;
+
+typedef struct {
+  GArray* keys;
+  GString* text;
+  bool recording;
+  bool playing;
+  bool closed;
+} Macro;
+
+
+Macro* macro_init();
+void macro_close(Macro* macro);
+bool macro_start(Macro* macro);
+unsigned macro_stop(Macro* macro);
+bool macro_is_recording(Macro* macro);
+void macro_record(Macro* macro, unsigned keyval, unsigned state);
+unsigned macro_get_length(Macro* macro);
+bool macro_play(Macro* macro, unsigned count, const MacroSink* sink, void* user_data);
+
+#endif
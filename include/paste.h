@@ -0,0 +1,37 @@
+/**
+ * paste.h
+ *
+ * Copyright (c) 2026 endaaman
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license. See the LICENSE file for details.
+ */
+
+#ifndef PASTE_H
+#define PASTE_H
+
+#include "common.h"
+
+
+// Written to the PTY at once at most
+#define TYM_PASTE_CHUNK_SIZE 4096
+
+typedef struct {
+  VteTerminal* vte;
+  GString* buffer;
+  GArray* brackets;
+  size_t written;
+  unsigned watch_id;
+  GSList* requests;
+} Paste;
+
+
+Paste* paste_init(VteTerminal* vte);
+void paste_close(Paste* paste);
+void paste_append(Paste* paste, const char* text, bool bracketed);
+void paste_request(Paste* paste, GdkAtom selection, bool bracketed);
+bool paste_cancel(Paste* paste);
+bool paste_is_active(Paste* paste);
+void paste_get_progress(Paste* paste, size_t* written, size_t* total);
+
+#endif
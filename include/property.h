@@ -103,6 +103,12 @@ void setter_autohide(Context* context, const char* key, bool value);
 bool gettter_bold_is_bright(Context* context, const char* key);
 void setter_bold_is_bright(Context* context, const char* key, bool value);
 
+int getter_lua_timeout(Context* context, const char* key);
+void setter_lua_timeout(Context* context, const char* key, int value);
+
+bool getter_profile(Context* context, const char* key);
+void setter_profile(Context* context, const char* key, bool value);
+
 // color
 void setter_color_normal(Context* context, const char* key, const char* value);
 void setter_color_window_background(Context* context, const char* key, const char* value);
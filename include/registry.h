@@ -0,0 +1,31 @@
+/**
+ * registry.h
+ *
+ * Copyright (c) 2026 endaaman
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license. See the LICENSE file for details.
+ */
+
+#ifndef REGISTRY_H
+#define REGISTRY_H
+
+#include "common.h"
+
+
+typedef struct {
+  GHashTable* table;
+  GArray* bits;
+} Registry;
+
+
+Registry* registry_init();
+void registry_close(Registry* registry);
+int registry_acquire_id(Registry* registry);
+bool registry_add(Registry* registry, int id, void* item);
+bool registry_remove(Registry* registry, int id);
+void* registry_lookup(Registry* registry, int id);
+unsigned registry_size(Registry* registry);
+GArray* registry_get_ids(Registry* registry);
+
+#endif
@@ -0,0 +1,39 @@
+/**
+ * screen.h
+ *
+ * Copyright (c) 2026 endaaman
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license. See the LICENSE file for details.
+ */
+
+#ifndef SCREEN_H
+#define SCREEN_H
+
+#include "common.h"
+
+
+typedef struct {
+  size_t start;
+  size_t length;
+  bool wrapped;
+} ScreenRow;
+
+typedef struct {
+  GString* text;
+  GArray* rows;
+  glong cols;
+  bool cjk_wide;
+} Screen;
+
+
+Screen* screen_init(VteTerminal* vte);
+Screen* screen_init_from_text(const char* text, glong cols, bool cjk_wide);
+void screen_close(Screen* screen);
+unsigned screen_get_row_count(Screen* screen);
+const char* screen_get_row(Screen* screen, unsigned row, size_t* length);
+bool screen_is_wrapped(Screen* screen, unsigned row);
+bool screen_is_full(Screen* screen, unsigned row);
+glong screen_scan_row(Screen* screen, unsigned row, glong col, bool* full);
+
+#endif
@@ -0,0 +1,35 @@
+/**
+ * stats.h
+ *
+ * Copyright (c) 2026 endaaman
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license. See the LICENSE file for details.
+ */
+
+#ifndef STATS_H
+#define STATS_H
+
+#include "common.h"
+
+
+typedef struct {
+  unsigned count;
+  gint64 total;
+  gint64 max;
+} StatsEntry;
+
+typedef struct {
+  bool enabled;
+  GHashTable* entries;
+} Stats;
+
+
+Stats* stats_init();
+void stats_close(Stats* stats);
+void stats_reset(Stats* stats);
+gint64 stats_begin(Stats* stats);
+void stats_end(Stats* stats, const char* category, const char* name, gint64 started_at);
+void stats_add(Stats* stats, const char* category, const char* name, gint64 duration);
+
+#endif
@@ -0,0 +1,48 @@
+/**
+ * timer.h
+ *
+ * Copyright (c) 2026 endaaman
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license. See the LICENSE file for details.
+ */
+
+#ifndef TIMER_H
+#define TIMER_H
+
+#include "common.h"
+
+
+// Returns whether to run again after the interval
+typedef bool (*TimerFunc)(void* data);
+
+typedef struct {
+  unsigned id;
+  void* owner;
+  gint64 deadline;
+  unsigned interval;
+  TimerFunc func;
+  void* data;
+  GDestroyNotify destroy;
+  GSequenceIter* iter;
+  bool cancelled;
+} Timer;
+
+typedef struct {
+  GSequence* queue;
+  GHashTable* timers;
+  unsigned last_id;
+  unsigned slack;
+  GSource* source;
+} TimerWheel;
+
+
+TimerWheel* timer_wheel_init(unsigned slack);
+void timer_wheel_close(TimerWheel* wheel);
+unsigned timer_add(TimerWheel* wheel, void* owner, unsigned interval, TimerFunc func, void* data, GDestroyNotify destroy);
+bool timer_remove(TimerWheel* wheel, unsigned id, void* owner);
+void timer_remove_by_owner(TimerWheel* wheel, void* owner);
+gint64 timer_wheel_get_next_deadline(TimerWheel* wheel);
+void timer_wheel_dispatch(TimerWheel* wheel, gint64 now);
+
+#endif
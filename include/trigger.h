@@ -0,0 +1,49 @@
+/**
+ * trigger.h
+ *
+ * Copyright (c) 2026 endaaman
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license. See the LICENSE file for details.
+ */
+
+#ifndef TRIGGER_H
+#define TRIGGER_H
+
+#include "common.h"
+
+
+typedef enum {
+  TRIGGER_ACTION_FUNCTION,
+  TRIGGER_ACTION_NOTIFY,
+  TRIGGER_ACTION_BELL,
+} TriggerAction;
+
+typedef struct {
+  char* pattern;
+  TriggerAction action;
+  int ref;
+  unsigned group;
+  unsigned captures;
+} Trigger;
+
+typedef struct {
+  GArray* items;
+  pcre2_code* code;
+  pcre2_match_data* match_data;
+  bool scanning;
+} Triggers;
+
+// `line` is not NUL-terminated; the match is at [start, end) of it.
+typedef void (*TriggerFunc)(Trigger* trigger, const char* line, size_t length, size_t start, size_t end, void* user_data);
+
+
+Triggers* triggers_init();
+void triggers_close(Triggers* triggers);
+void triggers_clear(Triggers* triggers);
+char* triggers_add(Triggers* triggers, const char* pattern, TriggerAction action, int ref);
+bool triggers_build(Triggers* triggers);
+unsigned triggers_count(Triggers* triggers);
+unsigned triggers_scan(Triggers* triggers, const char* text, size_t length, TriggerFunc func, void* user_data);
+
+#endif
@@ -0,0 +1,30 @@
+/**
+ * tym_ffi.h
+ *
+ * Copyright (c) 2026 endaaman
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license. See the LICENSE file for details.
+ */
+
+#ifndef TYM_FFI_H
+#define TYM_FFI_H
+
+#include "common.h"
+#include "context.h"
+
+
+// Looked up by the FFI of LuaJIT out of the executable, which is linked with
+// --export-dynamic for that.
+int tym_ffi_get_int(Context* context, const char* key);
+bool tym_ffi_set_int(Context* context, const char* key, int value);
+bool tym_ffi_get_bool(Context* context, const char* key);
+bool tym_ffi_set_bool(Context* context, const char* key, bool value);
+int tym_ffi_get_cursor_column(Context* context);
+int tym_ffi_get_cursor_row(Context* context);
+bool tym_ffi_has_selection(Context* context);
+void tym_ffi_put(Context* context, const char* text, size_t length);
+
+void tym_ffi_register(lua_State* L, Context* context);
+
+#endif
@@ -13,7 +13,16 @@
 #include "common.h"
 
 void test_config();
+void test_context();
+void test_keymap();
+void test_macro();
 void test_option();
 void test_regex();
+void test_registry();
+void test_screen();
+void test_stats();
+void test_timer();
+void test_trigger();
+void test_variant();
 
 #endif
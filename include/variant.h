@@ -0,0 +1,21 @@
+/**
+ * variant.h
+ *
+ * Copyright (c) 2026 endaaman
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license. See the LICENSE file for details.
+ */
+
+#ifndef VARIANT_H
+#define VARIANT_H
+
+#include "common.h"
+
+
+GVariant* variant_from_lua(lua_State* L, int index, const char** error);
+GVariant* variant_tuple_from_lua(lua_State* L, int index, const char** error);
+void variant_push(lua_State* L, GVariant* v);
+int variant_push_children(lua_State* L, GVariant* v);
+
+#endif
@@ -0,0 +1,34 @@
+-- Cost of calling tym through the FFI against the Lua C API.
+--   $ tym --isolated -u lua/bench_ffi.lua
+-- Needs tym built with `--enable-luajit`.
+
+local tym = require('tym')
+
+local COUNT = 1000000
+
+local function measure(name, f)
+  local start = os.clock()
+  for i = 1, COUNT do
+    f(i)
+  end
+  local elapsed = os.clock() - start
+  print(string.format('%-24s %.3f s (%.3f us/call)', name, elapsed, elapsed / COUNT * 1000000))
+end
+
+tym.set_timeout(function()
+  local ffi = tym.ffi
+  if not ffi then
+    print('tym.ffi is not available')
+    tym.quit()
+    return
+  end
+  measure('tym.get', function() return tym.get('width') end)
+  measure('tym.ffi.get_int', function() return ffi.get_int('width') end)
+  measure('tym.set', function(i) tym.set('scrollback_length', i % 100 + 512) end)
+  measure('tym.ffi.set_int', function(i) ffi.set_int('scrollback_length', i % 100 + 512) end)
+  measure('tym.get_cursor_position', function() return tym.get_cursor_position() end)
+  measure('tym.ffi.get_cursor_position', function() return ffi.get_cursor_position() end)
+  measure('tym.has_selection', function() return tym.has_selection() end)
+  measure('tym.ffi.has_selection', function() return ffi.has_selection() end)
+  tym.quit()
+end, 1000)
@@ -0,0 +1,26 @@
+-- Typing latency of keys which have no keymap.
+--   $ tym --isolated -u lua/bench_keypress.lua
+-- BINDINGS keymaps are set so that the cost of looking them up shows. Every
+-- press goes through the same path as real typing (see `tym.send_key()`), and
+-- `x` is typed into the shell, so run it where that does no harm.
+
+local tym = require('tym')
+
+local BINDINGS = 200
+local COUNT = 10000
+
+local keymaps = {}
+for i = 1, BINDINGS do
+  keymaps['<Ctrl><Alt>F' .. (i % 35 + 1) .. ' ' .. string.char(97 + i % 26)] = function() end
+end
+tym.set_keymaps(keymaps)
+
+tym.set_timeout(function()
+  local start = tym.get_monotonic_time()
+  for i = 1, COUNT do
+    tym.send_key('x')
+  end
+  local elapsed = tym.get_monotonic_time() - start
+  print(string.format('%d presses: %.1f ms (%.2f us/press)', COUNT, elapsed, elapsed / COUNT * 1000))
+  tym.quit()
+end, 1000)
@@ -0,0 +1,34 @@
+-- Replaying a recorded macro against sending the same keys one by one.
+--   $ tym --isolated -u lua/bench_macro.lua
+-- The keys are typed into the shell, so run it where that does no harm.
+
+local tym = require('tym')
+
+local KEYS = 'echomacro'
+local COUNT = 100
+
+local function send_all()
+  for i = 1, #KEYS do
+    tym.send_key(KEYS:sub(i, i))
+  end
+  tym.send_key('<Ctrl>u')
+end
+
+tym.set_timeout(function()
+  local start = os.clock()
+  for i = 1, COUNT do
+    send_all()
+  end
+  local elapsed = os.clock() - start
+  local keys = COUNT * (#KEYS + 1)
+  print(string.format('send_key:   %d keys: %.3f s (%.2f us/key)', keys, elapsed, elapsed / keys * 1000000))
+
+  tym.macro_record()
+  send_all()
+  tym.macro_stop()
+  start = os.clock()
+  tym.macro_play(COUNT)
+  elapsed = os.clock() - start
+  print(string.format('macro_play: %d keys: %.3f s (%.2f us/key)', keys, elapsed, elapsed / keys * 1000000))
+  tym.quit()
+end, 1000)
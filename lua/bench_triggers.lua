@@ -0,0 +1,64 @@
+-- Throughput of output with and without triggers.
+--   $ tym --isolated -u lua/bench_triggers.lua
+-- LINES lines are fed to VTE as if a program printed them, a CHUNK at a time
+-- from an interval so that the deliveries of the output come in between as
+-- they do with a real program. It is done once with no trigger and once with
+-- TRIGGERS of them, and the time until the last line reaches the output hook
+-- is compared. One of the triggers matches every line and counts them, so
+-- that it is checked that no line was skipped. As the output is delivered
+-- from the main loop, the time is measured on the wall clock.
+
+local tym = require('tym')
+
+local TRIGGERS = 50
+local LINES = 100000
+local CHUNK = 1000
+
+local line = string.rep('lorem ipsum dolor sit amet ', 4) .. '\r\n'
+local chunk = string.rep(line, CHUNK)
+
+local scanned = 0
+local triggers = {
+  { pattern = '^lorem', action = function() scanned = scanned + 1 end },
+}
+for i = 2, TRIGGERS do
+  triggers[i] = { pattern = 'NEVER' .. i .. '\\b', action = function() end }
+end
+
+-- lines fed between two deliveries must not go out of the scrollback, even
+-- when each of them is wrapped
+tym.set('scrollback_length', LINES * 2)
+
+local function run(label, done)
+  local start = tym.get_monotonic_time()
+  tym.set_hook('output', function(text)
+    if text:find('BENCH END', 1, true) then
+      tym.set_hook('output', nil)
+      local elapsed = (tym.get_monotonic_time() - start) / 1000
+      print(string.format('%s: %d lines %.3f s (%.2f us/line)', label, LINES, elapsed, elapsed / LINES * 1000000))
+      done()
+    end
+  end)
+  local fed = 0
+  local tag
+  tag = tym.set_interval(function()
+    if fed < LINES then
+      tym.feed(chunk)
+      fed = fed + CHUNK
+      return
+    end
+    tym.clear_interval(tag)
+    tym.feed('BENCH END\r\n')
+  end)
+end
+
+tym.set_timeout(function()
+  run('no trigger', function()
+    tym.set_triggers(triggers)
+    scanned = 0
+    run(TRIGGERS .. ' triggers', function()
+      assert(scanned == LINES, string.format('%d of %d lines were scanned', scanned, LINES))
+      tym.quit()
+    end)
+  end)
+end, 1000)
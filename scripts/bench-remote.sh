@@ -0,0 +1,26 @@
+#!/bin/bash
+
+# Measures how many `tym --call`/`--signal` invocations complete per second.
+# Run it inside a tym window, or pass the destination id as the first argument.
+# Set $TYM to compare another build, e.g. the one before a change.
+
+set -eu
+
+p=$(dirname "$0")
+tym=${TYM:-$p/../src/tym}
+dest=${1:-${TYM_ID:-0}}
+count=${COUNT:-200}
+
+bench() {
+  local start end
+  start=$(date +%s%N)
+  for _ in $(seq "$count"); do
+    "$tym" "$@" --dest "$dest" > /dev/null
+  done
+  end=$(date +%s%N)
+  awk -v n="$count" -v ns="$((end - start))" -v label="$*" \
+    'BEGIN { printf "%-28s %8.1f invocations/sec\n", label, n / (ns / 1e9) }'
+}
+
+bench --call echo --param ping
+bench --signal hook --param ping
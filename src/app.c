@@ -8,9 +8,17 @@
  */
 
 #include "app.h"
+#include "screen.h"
 
 App* app = NULL;
 
+// How long the selection has to stay unchanged before the hooks are called
+#define TYM_SELECTION_DEBOUNCE 100
+// Title changes are applied at most once in this interval, about a frame
+#define TYM_TITLE_INTERVAL 16
+// Timers due within this many milliseconds of each other share a wakeup
+#define TYM_TIMER_SLACK 4
+
 
 int on_local_options(GApplication* gapp, GVariantDict* values, void* user_data);
 int on_command_line(GApplication* app, GApplicationCommandLine* cli, void* user_data);
@@ -21,6 +29,9 @@ void app_init()
   app = g_new0(App, 1);
   app->meta = meta_init();
   app->ipc = ipc_init();
+  app->contexts = registry_init();
+  app->timers = timer_wheel_init(TYM_TIMER_SLACK);
+  app->program_paths = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
 #ifdef TYM_USE_VTE_TERMPROP
   // VTE does not implement OSC 52, so the clipboard is written through a termprop
   // of our own instead. `VTE_PROPERTY_DATA` takes base64 in the sequence and hands
@@ -36,38 +47,39 @@ void app_init()
 void app_close()
 {
   df();
-  for (GList* li = app->contexts; li != NULL; li = li->next) {
-    Context* c = (Context*)li->data;
-    context_close(c);
+  GArray* ids = registry_get_ids(app->contexts);
+  for (unsigned i = 0; i < ids->len; i++) {
+    context_close(registry_lookup(app->contexts, g_array_index(ids, int, i)));
+  }
+  g_array_unref(ids);
+  registry_close(app->contexts);
+  timer_wheel_close(app->timers);
+  g_hash_table_destroy(app->program_paths);
+  if (app->gapp) {
+    g_application_quit(app->gapp);
+    g_object_unref(app->gapp);
   }
-  g_application_quit(app->gapp);
-  g_object_unref(app->gapp);
   meta_close(app->meta);
   ipc_close(app->ipc);
   g_free(app);
 }
 
 static char* _get_dest_path_from_option(Option* option) {
-  char* path = NULL;
   char* dest = option_get_str(option, "dest");
   if (dest) {
-    path = g_strdup_printf(TYM_OBJECT_PATH_FMT_STR, dest);
-  } else {
-    char** env = g_get_environ();
-    const char* dest_str = g_environ_getenv(env, "TYM_ID");
-    if (!dest_str) {
-      return NULL;
-    }
-    path = g_strdup_printf(TYM_OBJECT_PATH_FMT_STR, dest_str);
+    return g_strdup_printf(TYM_OBJECT_PATH_FMT_STR, dest);
   }
-  return path;
+  const char* dest_str = g_getenv("TYM_ID");
+  if (!dest_str) {
+    return NULL;
+  }
+  return g_strdup_printf(TYM_OBJECT_PATH_FMT_STR, dest_str);
 }
 
-static int _perform_signal(char* dest_path, char* signal_name, char* method_name, char* param)
+static int _perform_signal(GDBusConnection* conn, char* dest_path, char* signal_name, char* method_name, char* param)
 {
   GError* error = NULL;
 
-  GDBusConnection* conn = g_application_get_dbus_connection(app->gapp);
   if (!dest_path) {
     g_warning("--dest is not provided and $TYM_ID is not set.");
     return 1;
@@ -81,11 +93,12 @@ static int _perform_signal(char* dest_path, char* signal_name, char* method_name
   if (signal_name) {
     g_dbus_connection_emit_signal(conn, NULL, dest_path, TYM_APP_ID, signal_name, params, &error);
     g_print("Sent signal:%s to path:%s interface:%s\n", signal_name, dest_path, TYM_APP_ID);
-    g_free(signal_name);
     if (error) {
       g_error("%s", error->message);
       g_error_free(error);
     }
+    /* The process exits right after this, so the signal must leave the outgoing queue now */
+    g_dbus_connection_flush_sync(conn, NULL, NULL);
     return 0;
   }
 
@@ -113,9 +126,99 @@ static int _perform_signal(char* dest_path, char* signal_name, char* method_name
   char* msg = g_variant_print(result, true);
   g_print("%s\n", msg);
   g_free(msg);
+  g_variant_unref(result);
   return 0;
 }
 
+int app_perform_remote(Option* option)
+{
+  df();
+  GError* error = NULL;
+  /* A bare bus connection is enough to reach the remote instance. Going through */
+  /* GApplication here would initialize GTK and register on the bus for nothing. */
+  GDBusConnection* conn = g_bus_get_sync(G_BUS_TYPE_SESSION, NULL, &error);
+  if (!conn) {
+    g_warning("Could not connect to the session bus: %s", error->message);
+    g_error_free(error);
+    return 1;
+  }
+  char* dest_path = _get_dest_path_from_option(option);
+  int code = _perform_signal(
+    conn,
+    dest_path,
+    option_get_str(option, "signal"),
+    option_get_str(option, "call"),
+    option_get_str(option, "param")
+  );
+  g_free(dest_path);
+  g_object_unref(conn);
+  return code;
+}
+
+#ifdef TYM_USE_DBUS_ACTIVATION
+/* Lets the bus start the daemon (via systemd when it is configured so) and waits
+ * until it owns the name, so that the registration below finds it as the primary
+ * instance instead of starting up cold by itself. */
+static void _activate_daemon()
+{
+  GError* error = NULL;
+  GDBusConnection* conn = g_bus_get_sync(G_BUS_TYPE_SESSION, NULL, &error);
+  if (!conn) {
+    dd("Could not connect to the session bus: %s", error->message);
+    g_error_free(error);
+    return;
+  }
+  GVariant* result = g_dbus_connection_call_sync(
+    conn,
+    "org.freedesktop.DBus",
+    "/org/freedesktop/DBus",
+    "org.freedesktop.DBus",
+    "StartServiceByName",
+    g_variant_new("(su)", TYM_APP_ID, 0),
+    G_VARIANT_TYPE("(u)"),
+    G_DBUS_CALL_FLAGS_NONE,
+    -1,
+    NULL,
+    &error
+  );
+  if (result) {
+    g_variant_unref(result);
+  } else {
+    /* No service file is installed or the daemon failed. Start by ourselves. */
+    dd("Could not activate the daemon: %s", error->message);
+    g_error_free(error);
+  }
+  g_object_unref(conn);
+}
+#endif
+
+/* The `sd_notify()` protocol: a datagram to the socket systemd passes via
+ * `$NOTIFY_SOCKET`. A leading '@' means an abstract socket. */
+static void _notify_ready()
+{
+  const char* path = g_getenv("NOTIFY_SOCKET");
+  if (!path || !path[0]) {
+    return;
+  }
+  GError* error = NULL;
+  GSocketAddress* addr = path[0] == '@'
+    ? g_unix_socket_address_new_with_type(path + 1, -1, G_UNIX_SOCKET_ADDRESS_ABSTRACT)
+    : g_unix_socket_address_new(path);
+  GSocket* sock = g_socket_new(G_SOCKET_FAMILY_UNIX, G_SOCKET_TYPE_DATAGRAM, G_SOCKET_PROTOCOL_DEFAULT, &error);
+  if (sock) {
+    const char state[] = "READY=1";
+    g_socket_send_to(sock, addr, state, sizeof(state) - 1, NULL, &error);
+    g_object_unref(sock);
+  }
+  if (error) {
+    g_warning("Could not notify the service manager: %s", error->message);
+    g_error_free(error);
+  }
+  g_object_unref(addr);
+  /* Not to be inherited by the shells */
+  g_unsetenv("NOTIFY_SOCKET");
+}
+
 int app_start(Option* option, int argc, char **argv)
 {
   df();
@@ -128,6 +231,12 @@ int app_start(Option* option, int argc, char **argv)
     app_id = TYM_APP_ID_ISOLATED;
   }
 
+#ifdef TYM_USE_DBUS_ACTIVATION
+  if (!option_get_bool(option, "isolated") && !option_get_bool(option, "daemon")) {
+    _activate_daemon();
+  }
+#endif
+
   app->gapp = G_APPLICATION(gtk_application_new(app_id, flags));
   GError* error = NULL;
   g_application_register(app->gapp, NULL, &error);
@@ -137,38 +246,31 @@ int app_start(Option* option, int argc, char **argv)
   return g_application_run(app->gapp, argc, argv);
 }
 
-static int _contexts_sort_func(const void* a, const void* b)
+Context* app_get_context(int id)
 {
-  return ((Context*)a)->id - ((Context*)b)->id;
+  return (Context*)registry_lookup(app->contexts, id);
 }
 
 Context* app_spawn_context(Option* option)
 {
   df();
-  unsigned index = 0;
-  int ordered_id = option_get_int(option, "id");
-  if (ordered_id) {
-    for (GList* li = app->contexts; li != NULL; li = li->next) {
-      Context* c = (Context*)li->data;
-      if (c->id == ordered_id) {
-        context_log_warn(c, true, "id=%d has been already acquired.", ordered_id);
-        return NULL;
-      }
+  int id = option_get_int(option, "id");
+  if (id) {
+    Context* c = app_get_context(id);
+    if (c) {
+      context_log_warn(c, true, "id=%d has been already acquired.", id);
+      return NULL;
     }
-    index = ordered_id;
-  } else {
-    for (GList* li = app->contexts; li != NULL; li = li->next) {
-      Context* c = (Context*)li->data;
-      /* scanning from 0 and if find first ctx that is not continus from 0, the index is new index. */
-      if (c->id != index) {
-        break;
-      }
-      index += 1;
+    if (id < 0) {
+      g_warning("id=%d is invalid. It must not be negative.", id);
+      return NULL;
     }
+  } else {
+    id = registry_acquire_id(app->contexts);
   }
 
-  Context* context = context_init(index, option);
-  app->contexts = g_list_insert_sorted(app->contexts, context, _contexts_sort_func);
+  Context* context = context_init(id, option);
+  registry_add(app->contexts, id, context);
   g_application_hold(app->gapp);
 
   context_log_message(context, false, "Started.");
@@ -182,7 +284,7 @@ void app_quit_context(Context* context)
   GDBusConnection* conn = g_application_get_dbus_connection(app->gapp);
   g_dbus_connection_unregister_object(conn, context->registration_id);
   context_log_message(context, false, "Quit.");
-  app->contexts = g_list_remove(app->contexts, context);
+  registry_remove(app->contexts, context->id);
   context_close(context);
 }
 
@@ -224,27 +326,72 @@ static void on_vte_drag_data_received(
   g_regex_unref(regex);
 }
 
+// Only keys pressed while recording both before and after are recorded, so
+// that neither the key starting nor the one stopping it goes in the macro.
+static void record_key(Context* context, GdkEventKey* event, bool recording)
+{
+  if (recording && !event->is_modifier && macro_is_recording(context->macro)) {
+    macro_record(context->macro, event->keyval, event->state & gtk_accelerator_get_default_mod_mask());
+  }
+}
+
 static bool on_vte_key_press(GtkWidget* widget, GdkEventKey* event, void* user_data)
 {
   Context* context = (Context*)user_data;
+  bool recording = macro_is_recording(context->macro);
+  if (!keymap_may_handle(context->keymap, event->keyval)) {
+    record_key(context, event, recording);
+    return false;
+  }
 
   unsigned mod = event->state & gtk_accelerator_get_default_mod_mask();
   unsigned key = gdk_keyval_to_lower(event->keyval);
 
-  if (context_perform_keymap(context, key, mod)) {
-    return true;
+  bool handled = context_perform_keymap(context, key, mod);
+  record_key(context, event, recording);
+  return handled;
+}
+
+static gboolean on_vte_scroll_tick(GtkWidget* widget, GdkFrameClock* clock, void* user_data)
+{
+  Context* context = (Context*)user_data;
+  ScrollState* scroll = &context->scroll;
+  if (!scroll->pending) {
+    /* No scroll during the last frame. Back to delivering immediately. */
+    scroll->tick_id = 0;
+    return G_SOURCE_REMOVE;
   }
-  return false;
+  bool result = false;
+  scroll->suppressed = hook_perform_scroll(context->hook, context->lua, scroll->delta_x, scroll->delta_y, scroll->x, scroll->y, &result) && result;
+  scroll->delta_x = 0;
+  scroll->delta_y = 0;
+  scroll->pending = false;
+  return G_SOURCE_CONTINUE;
 }
 
 static bool on_vte_mouse_scroll(GtkWidget* widget, GdkEventScroll* e, void* user_data)
 {
   Context* context = (Context*)user_data;
   bool result = false;
-  if (hook_perform_scroll(context->hook, context->lua, e->delta_x, e->delta_y, e->x, e->y, &result) && result) {
-    return true;
+  if (!context_get_bool(context, "coalesce_scroll")) {
+    return hook_perform_scroll(context->hook, context->lua, e->delta_x, e->delta_y, e->x, e->y, &result) && result;
   }
-  return false;
+
+  /* The first event is delivered at once and starts ticking. The following
+   * ones within the frame are summed up for the next tick, and they take the
+   * verdict of the last delivery since the event has to be answered now. */
+  ScrollState* scroll = &context->scroll;
+  if (scroll->tick_id) {
+    scroll->delta_x += e->delta_x;
+    scroll->delta_y += e->delta_y;
+    scroll->x = e->x;
+    scroll->y = e->y;
+    scroll->pending = true;
+    return scroll->suppressed;
+  }
+  scroll->suppressed = hook_perform_scroll(context->hook, context->lua, e->delta_x, e->delta_y, e->x, e->y, &result) && result;
+  scroll->tick_id = gtk_widget_add_tick_callback(widget, on_vte_scroll_tick, context, NULL);
+  return scroll->suppressed;
 }
 
 static void on_vte_child_exited(VteTerminal* vte, int status, void* user_data)
@@ -255,10 +402,11 @@ static void on_vte_child_exited(VteTerminal* vte, int status, void* user_data)
   app_quit_context(context);
 }
 
-static void on_vte_title_changed(VteTerminal* vte, void* user_data)
+static int _apply_title(void* user_data)
 {
   df();
   Context* context = (Context*)user_data;
+  context->title_tag = 0;
   GtkWindow* window = context->layout.window;
   bool result = false;
 
@@ -269,11 +417,23 @@ static void on_vte_title_changed(VteTerminal* vte, void* user_data)
 #endif
 
   if (hook_perform_title(context->hook, context->lua, title, &result) && result) {
-    return;
+    return G_SOURCE_REMOVE;
   }
-  if (title) {
+  /* Setting the title is a round trip to the window manager */
+  if (title && !is_equal(title, gtk_window_get_title(window))) {
     gtk_window_set_title(window, title);
   }
+  return G_SOURCE_REMOVE;
+}
+
+static void on_vte_title_changed(VteTerminal* vte, void* user_data)
+{
+  Context* context = (Context*)user_data;
+  /* Progress shown in the title can change it many times a frame. Only the
+   * title at the end of the interval goes to the hook and the window. */
+  if (!context->title_tag) {
+    context->title_tag = g_timeout_add(TYM_TITLE_INTERVAL, _apply_title, context);
+  }
 }
 
 static void on_vte_bell(VteTerminal* vte, void* user_data)
@@ -346,100 +506,6 @@ static void on_vte_clipboard_flags_termprop_changed(VteTerminal* vte, const char
 }
 #endif
 
-static glong _cell_width(gunichar c, bool cjk_wide)
-{
-  if (g_unichar_iszerowidth(c)) {
-    return 0;
-  }
-  if (cjk_wide ? g_unichar_iswide_cjk(c) : g_unichar_iswide(c)) {
-    return 2;
-  }
-  return 1;
-}
-
-static bool _row_is_full(const char* text, glong cols, bool cjk_wide)
-{
-  glong width = 0;
-  for (const char* p = text; *p; p = g_utf8_next_char(p)) {
-    width += _cell_width(g_utf8_get_char(p), cjk_wide);
-    if (width >= cols) {
-      return true;
-    }
-  }
-  return false;
-}
-
-// byte offset of the character covering `col`, or -1 when the cell is empty.
-// also reports whether the row is filled up to the last column.
-static glong _scan_row(const char* text, glong col, glong cols, bool cjk_wide, bool* full)
-{
-  glong width = 0;
-  glong offset = -1;
-  for (const char* p = text; *p; p = g_utf8_next_char(p)) {
-    glong w = _cell_width(g_utf8_get_char(p), cjk_wide);
-    if (offset < 0 && col < width + w) {
-      offset = p - text;
-    }
-    width += w;
-    if (offset >= 0 && width >= cols) {
-      *full = true;
-      return offset;
-    }
-  }
-  *full = width >= cols;
-  return offset;
-}
-
-// Cut a line into the rows it occupies on screen. VTE reports a paragraph
-// soft-wrapped by itself as a single line, so anything wider than the screen
-// is put back on the grid the click coordinates address.
-static void _append_screen_rows(GPtrArray* rows, const char* line, glong cols, bool cjk_wide)
-{
-  const char* head = line;
-  glong width = 0;
-  bool wrapped = false;
-  for (const char* p = line; *p; p = g_utf8_next_char(p)) {
-    width += _cell_width(g_utf8_get_char(p), cjk_wide);
-    if (width >= cols) {
-      const char* next = g_utf8_next_char(p);
-      g_ptr_array_add(rows, g_strndup(head, next - head));
-      head = next;
-      width = 0;
-      wrapped = true;
-    }
-  }
-  if (*head || !wrapped) {
-    g_ptr_array_add(rows, g_strdup(head));
-  }
-}
-
-// The rows currently on screen, top first. They are taken from the visible
-// text as a whole rather than read one by one out of the scrollback ring:
-// while the alternate screen is up -- which is where TUI apps live -- the
-// vertical adjustment reports `[0, row_count)` although the ring keeps
-// numbering rows from the scrollback, so row numbers derived from the
-// adjustment address rows that are not the ones on screen.
-static GPtrArray* _get_screen_rows(VteTerminal* vte, glong cols, bool cjk_wide)
-{
-  char* text = tym_get_visible_text(vte);
-  if (!text) {
-    return NULL;
-  }
-  GPtrArray* rows = g_ptr_array_new_with_free_func(g_free);
-  char** lines = g_strsplit(text, "\n", -1);
-  g_free(text);
-  guint count = g_strv_length(lines);
-  // the visible text ends with a line break, which is not a row of its own
-  if (count > 1 && is_empty(lines[count - 1])) {
-    --count;
-  }
-  for (guint i = 0; i < count; i++) {
-    _append_screen_rows(rows, lines[i], cols, cjk_wide);
-  }
-  g_strfreev(lines);
-  return rows;
-}
-
 // Detect an URI spanning hard-wrapped lines. VTE joins soft-wrapped lines when
 // matching, but TUI apps that wrap text by themselves (e.g. Ink-based ones)
 // emit hard line breaks, so VTE matches only a single-line fragment. Here rows
@@ -460,7 +526,6 @@ static char* check_wrapped_uri(Context* context, VteTerminal* vte, GdkEventButto
   if (cols <= 0 || char_width <= 0 || char_height <= 0) {
     return NULL;
   }
-  bool cjk_wide = vte_terminal_get_cjk_ambiguous_width(vte) == 2;
 
   GtkStyleContext* style = gtk_widget_get_style_context(GTK_WIDGET(vte));
   GtkBorder padding;
@@ -472,23 +537,23 @@ static char* check_wrapped_uri(Context* context, VteTerminal* vte, GdkEventButto
     return NULL;
   }
 
-  GPtrArray* rows = _get_screen_rows(vte, cols, cjk_wide);
-  if (!rows) {
+  Screen* screen = screen_init(vte);
+  if (!screen) {
     return NULL;
   }
-  glong count = (glong)rows->len;
+  glong count = (glong)screen_get_row_count(screen);
   if (row >= count) {
     // clicked below the last row holding text
-    g_ptr_array_free(rows, true);
+    screen_close(screen);
     return NULL;
   }
 
-  const char* text = g_ptr_array_index(rows, row);
+  const char* text = screen_get_row(screen, row, NULL);
   bool full = false;
-  glong offset = _scan_row(text, col, cols, cjk_wide, &full);
+  glong offset = screen_scan_row(screen, row, col, &full);
   if (offset < 0) {
     // clicked on an empty cell
-    g_ptr_array_free(rows, true);
+    screen_close(screen);
     return NULL;
   }
 
@@ -496,30 +561,29 @@ static char* check_wrapped_uri(Context* context, VteTerminal* vte, GdkEventButto
   // filled up to the last column
   glong first = row;
   while (first > 0 && row - first < MAX_JOINED_ROWS
-         && _row_is_full(g_ptr_array_index(rows, first - 1), cols, cjk_wide)) {
+         && screen_is_full(screen, first - 1)) {
     --first;
   }
 
   if (!full && first == row) {
     // no wrapping around the clicked row; leave it to the plain VTE match
-    g_ptr_array_free(rows, true);
+    screen_close(screen);
     return NULL;
   }
 
   GString* joined = g_string_new(NULL);
   for (glong r = first; r < row; r++) {
-    g_string_append(joined, g_ptr_array_index(rows, r));
+    g_string_append(joined, screen_get_row(screen, r, NULL));
   }
   PCRE2_SIZE clicked = joined->len + offset;
   g_string_append(joined, text);
 
   // join rows downward while the last joined row is filled up to the last column
   for (glong r = row; full && r + 1 < count && r - row < MAX_JOINED_ROWS; r++) {
-    const char* t = g_ptr_array_index(rows, r + 1);
-    full = _row_is_full(t, cols, cjk_wide);
-    g_string_append(joined, t);
+    full = screen_is_full(screen, r + 1);
+    g_string_append(joined, screen_get_row(screen, r + 1, NULL));
   }
-  g_ptr_array_free(rows, true);
+  screen_close(screen);
 
   char* uri = NULL;
   pcre2_match_data* match_data = pcre2_match_data_create_from_pattern(code, NULL);
@@ -573,18 +637,45 @@ static bool on_vte_click(VteTerminal* vte, GdkEventButton* event, void* user_dat
   return false;
 }
 
-static void on_vte_selection_changed(GtkWidget* widget, void* user_data)
+static int _perform_selection_hooks(void* user_data)
 {
-  df();
   Context* context = (Context*)user_data;
+  context->selection_tag = 0;
   if (!vte_terminal_get_has_selection(context->layout.vte)) {
     hook_perform_unselected(context->hook, context->lua);
-    return;
+    return G_SOURCE_REMOVE;
+  }
+  if (!hook_is_set(context->hook, HOOK_SELECTED)) {
+    return G_SOURCE_REMOVE;
+  }
+  /* Older VTE waits for PRIMARY in a nested main loop, in which the context
+   * may be closed, or the selection changed again and debounced anew.
+   * context_close() clears `alive` in the former case. */
+  Context* alive = context;
+  context->selection_waiter = &alive;
+  char* text = tym_get_selected_text(context->layout.vte);
+  if (!alive) {
+    g_free(text);
+    return G_SOURCE_REMOVE;
+  }
+  context->selection_waiter = NULL;
+  if (context->selection_tag) {
+    g_free(text);
+    return G_SOURCE_REMOVE;
   }
-  GtkClipboard* cb = gtk_clipboard_get(GDK_SELECTION_PRIMARY);
-  char* text = gtk_clipboard_wait_for_text(cb);
   hook_perform_selected(context->hook, context->lua, text);
   g_free(text);
+  return G_SOURCE_REMOVE;
+}
+
+static void on_vte_selection_changed(GtkWidget* widget, void* user_data)
+{
+  Context* context = (Context*)user_data;
+  /* Dragging changes the selection on every motion. Wait for it to settle. */
+  if (context->selection_tag) {
+    g_source_remove(context->selection_tag);
+  }
+  context->selection_tag = g_timeout_add(TYM_SELECTION_DEBOUNCE, _perform_selection_hooks, context);
 }
 
 static void on_vte_resize_request(GtkWidget* widget, unsigned int width, unsigned int height, void* user_data)
@@ -637,10 +728,194 @@ static gboolean on_window_draw(GtkWidget* widget, cairo_t* cr, void* user_data)
   return false;
 }
 
+static gboolean on_window_resize_tick(GtkWidget* widget, GdkFrameClock* clock, void* user_data)
+{
+  Context* context = (Context*)user_data;
+  context->resize_tick_id = 0;
+  VteTerminal* vte = context->layout.vte;
+  hook_perform_resized(
+    context->hook,
+    context->lua,
+    vte_terminal_get_column_count(vte),
+    vte_terminal_get_row_count(vte),
+    gtk_widget_get_allocated_width(widget),
+    gtk_widget_get_allocated_height(widget)
+  );
+  return G_SOURCE_REMOVE;
+}
+
 static void on_window_resize(GtkWidget* widget, GtkAllocation* allocation, gpointer user_data)
 {
   Context* context = (Context*)user_data;
-  hook_perform_resized(context->hook, context->lua);
+  /* Allocations come repeatedly while the window is dragged. The hook gets
+   * the final geometry once per frame. */
+  if (!context->resize_tick_id) {
+    context->resize_tick_id = gtk_widget_add_tick_callback(widget, on_window_resize_tick, context, NULL);
+  }
+}
+
+// The output hook is passed only this many lines of the last ones
+#define TYM_OUTPUT_MAX_LINES 1000
+// Output is delivered at most once in this many milliseconds
+#define TYM_OUTPUT_INTERVAL 16
+
+static long _get_cursor_row(VteTerminal* vte)
+{
+  long row = 0;
+  vte_terminal_get_cursor_position(vte, NULL, &row);
+  return row;
+}
+
+// The oldest row surely still in the ring, which holds the scrollback and the
+// screen the cursor is on
+static long _get_oldest_row(VteTerminal* vte, long cursor_row)
+{
+  long lines = vte_terminal_get_scrollback_lines(vte);
+  return lines < 0 ? 0 : MAX(0, cursor_row - lines);
+}
+
+static const char* _get_last_lines(const char* text, unsigned count)
+{
+  const char* p = text + strlen(text);
+  while (p > text) {
+    if (p[-1] == '\n' && count-- == 1) {
+      break;
+    }
+    p--;
+  }
+  return p;
+}
+
+static void _perform_trigger(Trigger* trigger, const char* line, size_t length, size_t start, size_t end, void* user_data)
+{
+  Context* context = (Context*)user_data;
+  switch (trigger->action) {
+    case TRIGGER_ACTION_NOTIFY: {
+      char* body = g_strndup(line, length);
+      context_notify(context, body, NULL);
+      g_free(body);
+      break;
+    }
+    case TRIGGER_ACTION_BELL:
+      gdk_window_beep(context_get_gdk_window(context));
+      break;
+    case TRIGGER_ACTION_FUNCTION: {
+      lua_State* L = context->lua;
+      lua_rawgeti(L, LUA_REGISTRYINDEX, trigger->ref);
+      lua_pushlstring(L, line, length);
+      lua_pushlstring(L, line + start, end - start);
+      gint64 started_at = stats_begin(context->stats);
+      int status = context_pcall(context, 2, 0);
+      stats_end(context->stats, "trigger", trigger->pattern, started_at);
+      if (status != LUA_OK) {
+        luaX_warn(L, "Error in trigger function: '%s'", lua_tostring(L, -1));
+        lua_pop(L, 1); // error
+      }
+      break;
+    }
+  }
+}
+
+/* The lines ending above the cursor's line are complete. The line the cursor
+ * is on may span rows soft-wrapped into the cursor row, so the text is read up
+ * to the cursor row and cut at the last line break; the mark then moves to the
+ * row the unfinished line starts at, counted by the same cell widths the
+ * Screen module uses. This way every line is delivered once and whole. The
+ * cursor going up past the mark, as on `clear` or a reset, only moves the
+ * mark. The triggers scan every line from the mark on that the ring still
+ * holds; only the rows gone out of the scrollback before the delivery are
+ * lost. The hook is passed the last TYM_OUTPUT_MAX_LINES lines of them. */
+static int _deliver_output(void* user_data)
+{
+  Context* context = (Context*)user_data;
+  OutputState* output = &context->output;
+  output->tag = 0;
+  VteTerminal* vte = context->layout.vte;
+  long row = _get_cursor_row(vte);
+  if (row <= output->row) {
+    output->row = row;
+    return G_SOURCE_REMOVE;
+  }
+  long start = MAX(output->row, _get_oldest_row(vte, row));
+  glong cols = vte_terminal_get_column_count(vte);
+  char* text = tym_get_text_range(vte, start, 0, row, cols);
+  char* br = text ? strrchr(text, '\n') : NULL;
+  if (!br) {
+    // still in the line the mark is on
+    output->row = start;
+    g_free(text);
+    return G_SOURCE_REMOVE;
+  }
+  // a text ending with a line break has no row after it, which counts an
+  // empty line before it right
+  br[1] = '\0';
+  Screen* screen = screen_init_from_text(text, cols, vte_terminal_get_cjk_ambiguous_width(vte) == 2);
+  output->row = MIN(start + (long)screen_get_row_count(screen), row);
+  screen_close(screen);
+  *br = '\0';
+  if (triggers_count(context->triggers) > 0) {
+    triggers_scan(context->triggers, text, strlen(text), _perform_trigger, context);
+  }
+  if (hook_is_set(context->hook, HOOK_OUTPUT)) {
+    hook_perform_output(context->hook, context->lua, _get_last_lines(text, TYM_OUTPUT_MAX_LINES));
+  }
+  g_free(text);
+  return G_SOURCE_REMOVE;
+}
+
+static void on_vte_contents_changed(VteTerminal* vte, void* user_data)
+{
+  Context* context = (Context*)user_data;
+  /* A program can change the contents many times a frame. A timer rather than
+   * the frame clock, which stops while the window is hidden or minimized. */
+  if (!context->output.tag) {
+    context->output.tag = g_timeout_add(TYM_OUTPUT_INTERVAL, _deliver_output, context);
+  }
+}
+
+typedef struct {
+  const char* signal;
+  GCallback callback;
+  bool on_window;
+  HookType hooks[2];
+} HookHandlerDef;
+
+static const HookHandlerDef HOOK_HANDLER_DEFS[HOOK_HANDLER_COUNT] = {
+  [HOOK_HANDLER_SCROLL]        = { "scroll-event"     , G_CALLBACK(on_vte_mouse_scroll)     , false, { HOOK_SCROLL, HOOK_SCROLL } },
+  [HOOK_HANDLER_SELECTION]     = { "selection-changed", G_CALLBACK(on_vte_selection_changed), false, { HOOK_SELECTED, HOOK_UNSELECTED } },
+  [HOOK_HANDLER_FOCUS_OUT]     = { "focus-out-event"  , G_CALLBACK(on_window_focus_out)     , true , { HOOK_DEACTIVATED, HOOK_DEACTIVATED } },
+  [HOOK_HANDLER_SIZE_ALLOCATE] = { "size-allocate"    , G_CALLBACK(on_window_resize)        , true , { HOOK_RESIZED, HOOK_RESIZED } },
+  [HOOK_HANDLER_CONTENTS]      = { "contents-changed" , G_CALLBACK(on_vte_contents_changed) , false, { HOOK_OUTPUT, HOOK_OUTPUT } },
+};
+
+/* These signals have no default action of tym, so they are connected only
+ * while any of their hooks is set and idle terminals skip marshalling them. */
+void app_sync_hook_handlers(Context* context)
+{
+  if (!context->layout.vte) {
+    return;
+  }
+  for (int i = 0; i < HOOK_HANDLER_COUNT; i++) {
+    const HookHandlerDef* def = &HOOK_HANDLER_DEFS[i];
+    HandlerTag* tag = &context->hook_handlers[i];
+    bool needed = hook_is_set(context->hook, def->hooks[0]) || hook_is_set(context->hook, def->hooks[1]);
+    if (i == HOOK_HANDLER_CONTENTS) {
+      needed = needed || triggers_count(context->triggers) > 0;
+    }
+    if (needed && !tag->handler_id) {
+      tag->object = def->on_window ? (void*)context->layout.window : (void*)context->layout.vte;
+      tag->handler_id = g_signal_connect(tag->object, def->signal, def->callback, context);
+      dd("connected `%s`", def->signal);
+      if (i == HOOK_HANDLER_CONTENTS) {
+        // what is already there is not new output
+        context->output.row = _get_cursor_row(context->layout.vte);
+      }
+    } else if (!needed && tag->handler_id) {
+      g_signal_handler_disconnect(tag->object, tag->handler_id);
+      tag->handler_id = 0;
+      dd("disconnected `%s`", def->signal);
+    }
+  }
 }
 
 void on_dbus_signal(
@@ -708,16 +983,6 @@ int on_local_options(GApplication* gapp, GVariantDict* values, void* user_data)
   df();
   Option* option = (Option*)(user_data);
 
-  char* dest_path = _get_dest_path_from_option(option);
-  char* signal_name = option_get_str(option, "signal");
-  char* method_name = option_get_str(option, "call");
-  char* param = option_get_str(option, "param");
-  if (signal_name || method_name) {
-    int code = _perform_signal(dest_path, signal_name, method_name, param);
-    g_free(dest_path);
-    return code;
-  }
-
   if (option_get_bool(option, "daemon")) {
     if (g_application_get_is_remote(app->gapp)) {
       /* If there is a normal primary instance, --daemon flag would make it "zombie" */
@@ -773,6 +1038,9 @@ static bool _subscribe_dbus(Context* context)
     "    <method name='get_ids'>"
     "      <arg type='ai' direction='out'/>"
     "    </method>"
+    "    <method name='get_stats'>"
+    "      <arg type='a{s(uxx)}' direction='out'/>"
+    "    </method>"
     "    <method name='eval'>"
     "      <arg type='s' direction='in'/>"
     "      <arg type='s' direction='out'/>"
@@ -811,12 +1079,95 @@ static bool _subscribe_dbus(Context* context)
   return true;
 }
 
+/* Resolves a program name against the client's $PATH. The result is
+ * remembered per pair of the name and the $PATH so that later spawns from the
+ * same environment only check the file is still executable instead of walking
+ * $PATH again. Returns NULL when `name` is a path or is not found, in which
+ * case spawning should search by itself. */
+static const char* _resolve_program(const char* name, const char* path_env)
+{
+  if (strchr(name, '/')) {
+    return NULL;
+  }
+  if (!path_env) {
+    path_env = g_getenv("PATH");
+  }
+  if (!path_env) {
+    return NULL;
+  }
+  char* key = g_strconcat(path_env, "\n", name, NULL);
+  char* path = g_hash_table_lookup(app->program_paths, key);
+  if (path && g_file_test(path, G_FILE_TEST_IS_EXECUTABLE)) {
+    g_free(key);
+    return path;
+  }
+  path = NULL;
+  char** dirs = g_strsplit(path_env, G_SEARCHPATH_SEPARATOR_S, -1);
+  for (char** d = dirs; *d && !path; d++) {
+    /* relative entries depend on the working directory, so leave them to the
+     * spawn */
+    if (!g_path_is_absolute(*d)) {
+      continue;
+    }
+    char* candidate = g_build_filename(*d, name, NULL);
+    if (g_file_test(candidate, G_FILE_TEST_IS_EXECUTABLE) && !g_file_test(candidate, G_FILE_TEST_IS_DIR)) {
+      path = candidate;
+    } else {
+      g_free(candidate);
+    }
+  }
+  g_strfreev(dirs);
+  if (!path) {
+    g_hash_table_remove(app->program_paths, key);
+    g_free(key);
+    return NULL;
+  }
+  g_hash_table_replace(app->program_paths, key, path);
+  return path;
+}
+
+static bool _is_env_overridden(const char* entry, char** overrides)
+{
+  for (char** o = overrides; *o; o++) {
+    size_t len = strchr(*o, '=') - *o + 1;
+    if (strncmp(entry, *o, len) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/* Builds the environment in a single pass. The entries are borrowed from `env`
+ * and `overrides`, so free only the returned array itself. */
+static char** _build_env(const char* const* env, char** overrides)
+{
+  unsigned env_len = g_strv_length((char**)env);
+  unsigned overrides_len = g_strv_length(overrides);
+  char** shell_env = g_new(char*, env_len + overrides_len + 1);
+  unsigned i = 0;
+  for (const char* const* e = env; *e; e++) {
+    if (!_is_env_overridden(*e, overrides)) {
+      shell_env[i++] = (char*)*e;
+    }
+  }
+  memcpy(&shell_env[i], overrides, sizeof(char*) * (overrides_len + 1));
+  return shell_env;
+}
+
+static void _record_spawn_latency(Context* context)
+{
+  context->spawn_latency = g_get_monotonic_time() - context->spawn_started_at;
+  stats_add(context->stats, "spawn", NULL, context->spawn_latency);
+  dd("spawn latency: %" G_GINT64_FORMAT "us", context->spawn_latency);
+}
+
 #ifdef TYM_USE_VTE_SPAWN_ASYNC
 static void on_vte_spawn(VteTerminal* vte, GPid child_pid, GError* error, void* user_data)
 {
   Context* context = (Context*)user_data;
   context->initialized = true;
   context->child_pid = child_pid;
+  _record_spawn_latency(context);
   if (error) {
     g_warning("vte-spawn error: %s", error->message);
     /* g_error_free(error); */
@@ -837,11 +1188,15 @@ int on_command_line(GApplication* gapp, GApplicationCommandLine* cli, void* user
   char** argv = g_application_command_line_get_arguments(cli, &argc);
 
   Option* option = option_init(meta_get_option_entries(app->meta));
-  if (!option_parse(option, argc, argv)){
+  bool parsed = option_parse(option, argc, argv);
+  g_strfreev(argv);
+  if (!parsed) {
+    option_close(option);
     return 1;
   };
 
   if (option_get_bool(option, "daemon")) {
+    option_close(option);
     GtkWindow* window = gtk_application_get_active_window(GTK_APPLICATION(gapp));
     if (window) {
       g_warning("Blocked another instance from trying to start as daemon process.");
@@ -852,17 +1207,20 @@ int on_command_line(GApplication* gapp, GApplicationCommandLine* cli, void* user
     window = GTK_WINDOW(gtk_application_window_new(GTK_APPLICATION(gapp)));
     UNUSED(window);
     g_message("Starting as daemon process.");
+    _notify_ready();
     return 0;
   }
 
   if (option_get_str(option, "signal") || option_get_str(option, "call")) {
-    /* Do nothing */
+    /* Do nothing. Current clients never get here since they send it without GApplication. */
     dd("D-Bus signal/method call was performed on a remote process.");
+    option_close(option);
     return 0;
   }
 
   Context* context = app_spawn_context(option);
   if (!context) {
+    option_close(option);
     return 1;
   }
 
@@ -885,12 +1243,10 @@ int on_command_line(GApplication* gapp, GApplicationCommandLine* cli, void* user
 
   context_signal_connect(context, vte, "drag-data-received", G_CALLBACK(on_vte_drag_data_received));
   context_signal_connect(context, vte, "key-press-event", G_CALLBACK(on_vte_key_press));
-  context_signal_connect(context, vte, "scroll-event", G_CALLBACK(on_vte_mouse_scroll));
   context_signal_connect(context, vte, "child-exited", G_CALLBACK(on_vte_child_exited));
   context_signal_connect(context, vte, "window-title-changed", G_CALLBACK(on_vte_title_changed));
   context_signal_connect(context, vte, "bell", G_CALLBACK(on_vte_bell));
   context_signal_connect(context, vte, "button-press-event", G_CALLBACK(on_vte_click));
-  context_signal_connect(context, vte, "selection-changed", G_CALLBACK(on_vte_selection_changed));
 #ifdef TYM_USE_VTE_TERMPROP
   context_signal_connect(context, vte, "termprop-changed::" TYM_TERMPROP_CLIPBOARD, G_CALLBACK(on_vte_clipboard_termprop_changed));
   context_signal_connect(context, vte, "termprop-changed::" TYM_TERMPROP_CLIPBOARD_FLAGS, G_CALLBACK(on_vte_clipboard_flags_termprop_changed));
@@ -898,9 +1254,7 @@ int on_command_line(GApplication* gapp, GApplicationCommandLine* cli, void* user
   context_signal_connect(context, vte, "resize-window", G_CALLBACK(on_vte_resize_request));
   context_signal_connect(context, window, "destroy", G_CALLBACK(on_window_close));
   context_signal_connect(context, window, "focus-in-event", G_CALLBACK(on_window_focus_in));
-  context_signal_connect(context, window, "focus-out-event", G_CALLBACK(on_window_focus_out));
   context_signal_connect(context, window, "draw", G_CALLBACK(on_window_draw));
-  context_signal_connect(context, window, "size-allocate", G_CALLBACK(on_window_resize));
 
   if (app->is_isolated) {
     g_message("This process is isolated so never listen to D-Bus signal/method call.");
@@ -934,23 +1288,28 @@ int on_command_line(GApplication* gapp, GApplicationCommandLine* cli, void* user
     }
   }
 
-  const char* const* env = g_application_command_line_get_environ(cli);
-  char** shell_env = g_new0(char*, g_strv_length((char**)env) + 1);
-  int i = 0;
-  while (env[i]) {
-    shell_env[i] = g_strdup(env[i]);
-    i += 1;
+  GSpawnFlags spawn_flags = G_SPAWN_SEARCH_PATH;
+  const char* const* client_env = g_application_command_line_get_environ(cli);
+  const char* program = shell_argv[0] ? _resolve_program(shell_argv[0], g_environ_getenv((char**)client_env, "PATH")) : NULL;
+  if (program) {
+    g_free(shell_argv[0]);
+    shell_argv[0] = g_strdup(program);
+    spawn_flags &= ~G_SPAWN_SEARCH_PATH;
   }
-  shell_env = g_environ_setenv(shell_env, "TERM", context_get_str(context, "term"), true);
-  char* id_str = g_strdup_printf("%i", context->id);
-  shell_env = g_environ_setenv(shell_env, "TYM_ID", id_str, true);
-  g_free(id_str);
+
+  char* overrides[] = {
+    g_strconcat("TERM=", context_get_str(context, "term"), NULL),
+    g_strdup_printf("TYM_ID=%i", context->id),
+    NULL,
+  };
+  char** shell_env = _build_env(client_env, overrides);
 
   const char* cwd = option_get_str(option, "cwd");
   if (cwd == NULL) {
     cwd = g_application_command_line_get_cwd(cli);
   }
 
+  context->spawn_started_at = g_get_monotonic_time();
 #ifdef TYM_USE_VTE_SPAWN_ASYNC
   vte_terminal_spawn_async(
     vte,                 // terminal
@@ -958,7 +1317,7 @@ int on_command_line(GApplication* gapp, GApplicationCommandLine* cli, void* user
     cwd,                 // working directory
     shell_argv,          // argv
     shell_env,           // envv
-    G_SPAWN_SEARCH_PATH, // spawn_flags
+    spawn_flags,         // spawn_flags
     NULL,                // child_setup
     NULL,                // child_setup_data
     NULL,                // child_setup_data_destroy
@@ -975,7 +1334,7 @@ int on_command_line(GApplication* gapp, GApplicationCommandLine* cli, void* user
     cwd,
     shell_argv,
     shell_env,
-    G_SPAWN_SEARCH_PATH,
+    spawn_flags,
     NULL,
     NULL,
     &child_pid,
@@ -983,9 +1342,12 @@ int on_command_line(GApplication* gapp, GApplicationCommandLine* cli, void* user
     &error
   );
   context->child_pid = child_pid;
+  _record_spawn_latency(context);
 
   if (error) {
-    g_strfreev(shell_env);
+    g_free(shell_env);
+    g_free(overrides[0]);
+    g_free(overrides[1]);
     g_strfreev(shell_argv);
     g_error("%s", error->message);
     g_error_free(error);
@@ -994,7 +1356,9 @@ int on_command_line(GApplication* gapp, GApplicationCommandLine* cli, void* user
   }
 #endif
 
-  g_strfreev(shell_env);
+  g_free(shell_env);
+  g_free(overrides[0]);
+  g_free(overrides[1]);
   g_strfreev(shell_argv);
   gtk_widget_grab_focus(GTK_WIDGET(vte));
   gtk_widget_show_all(GTK_WIDGET(context->layout.window));
@@ -0,0 +1,102 @@
+/**
+ * arena.c
+ *
+ * Copyright (c) 2026 endaaman
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license. See the LICENSE file for details.
+ */
+
+#include "arena.h"
+
+
+#define ARENA_ALIGNMENT 16
+#define ARENA_ALIGN(n) (((n) + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1))
+
+struct ArenaChunk {
+  ArenaChunk* next;
+  size_t size;
+  size_t used;
+};
+
+#define ARENA_CHUNK_HEADER_SIZE ARENA_ALIGN(sizeof(ArenaChunk))
+
+
+static ArenaChunk* arena_chunk_new(size_t size)
+{
+  ArenaChunk* chunk = g_malloc(ARENA_CHUNK_HEADER_SIZE + size);
+  chunk->next = NULL;
+  chunk->size = size;
+  chunk->used = 0;
+  return chunk;
+}
+
+Arena* arena_init(size_t chunk_size)
+{
+  Arena* arena = g_new0(Arena, 1);
+  arena->chunk_size = ARENA_ALIGN(chunk_size);
+  return arena;
+}
+
+void arena_close(Arena* arena)
+{
+  ArenaChunk* chunk = arena->head;
+  while (chunk) {
+    ArenaChunk* next = chunk->next;
+    g_free(chunk);
+    chunk = next;
+  }
+  g_free(arena);
+}
+
+// Returns zero-filled memory which lives until `arena_close()`.
+void* arena_alloc(Arena* arena, size_t size)
+{
+  size = ARENA_ALIGN(size);
+  ArenaChunk* chunk = arena->head;
+  if (!chunk || chunk->size - chunk->used < size) {
+    if (size > arena->chunk_size / 2) {
+      // A large block gets a chunk of its own, kept behind the current one so
+      // that the room left in the current chunk is still used.
+      ArenaChunk* large = arena_chunk_new(size);
+      if (chunk) {
+        large->next = chunk->next;
+        chunk->next = large;
+      } else {
+        arena->head = large;
+      }
+      chunk = large;
+    } else {
+      chunk = arena_chunk_new(arena->chunk_size);
+      chunk->next = arena->head;
+      arena->head = chunk;
+    }
+  }
+  void* ptr = (char*)chunk + ARENA_CHUNK_HEADER_SIZE + chunk->used;
+  chunk->used += size;
+  memset(ptr, 0, size);
+  return ptr;
+}
+
+char* arena_strdup(Arena* arena, const char* s)
+{
+  if (!s) {
+    return NULL;
+  }
+  size_t len = strlen(s) + 1;
+  return memcpy(arena_alloc(arena, len), s, len);
+}
+
+char* arena_strdup_printf(Arena* arena, const char* fmt, ...)
+{
+  va_list argp;
+  va_start(argp, fmt);
+  va_list argp_copy;
+  va_copy(argp_copy, argp);
+  int len = g_vsnprintf(NULL, 0, fmt, argp_copy);
+  va_end(argp_copy);
+  char* s = arena_alloc(arena, len + 1);
+  g_vsnprintf(s, len + 1, fmt, argp);
+  va_end(argp);
+  return s;
+}
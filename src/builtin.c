@@ -11,13 +11,13 @@
 #include "context.h"
 #include "command.h"
 #include "app.h"
+#include "screen.h"
+#include "variant.h"
+#include "tym_ffi.h"
 
 
-static int builtin_get(lua_State* L)
+static int push_config(lua_State* L, Context* context, const char* key)
 {
-  Context* context = (Context*)lua_touserdata(L, lua_upvalueindex(1));
-
-  const char* key = luaL_checkstring(L, 1);
   MetaEntry* e = meta_get_entry(app->meta, key);
   if (!e) {
     luaX_warn(L, "Invalid config key: '%s'", key);
@@ -42,29 +42,19 @@ static int builtin_get(lua_State* L)
   return 1;
 }
 
-static int builtin_quit(lua_State* L)
-{
-  Context* context = (Context*)lua_touserdata(L, lua_upvalueindex(1));
-  gtk_window_close(context->layout.window);
-  return 0;
-}
-
-static int builtin_set(lua_State* L)
+// Sets `key` to the value at `index`, warning when either is invalid.
+static void set_config(lua_State* L, Context* context, const char* key, int index)
 {
-  Context* context = (Context*)lua_touserdata(L, lua_upvalueindex(1));
-
-  const char* key = luaL_checkstring(L, 1);
-
   MetaEntry* e = meta_get_entry(app->meta, key);
   if (!e) {
     luaX_warn(L, "Invalid config key: '%s'", key);
-    return 0;
+    return;
   }
 
-  int type = lua_type(L, 2);
+  int type = lua_type(L, index);
   switch (e->type) {
     case META_ENTRY_TYPE_STRING: {
-      const char* value = lua_tostring(L, 2);
+      const char* value = lua_tostring(L, index);
       if (!value) {
         luaX_warn(L, "Invalid string config for '%s' (string expected, got %s)", key, lua_typename(L, type));
         break;
@@ -74,21 +64,40 @@ static int builtin_set(lua_State* L)
     }
     case META_ENTRY_TYPE_INTEGER: {
       if (type != LUA_TNUMBER) {
-        luaX_warn(L, "Invalid integer config for '%s': %s (number expected, got %s)", key, lua_tostring(L, 2), lua_typename(L, type));
+        luaX_warn(L, "Invalid integer config for '%s': %s (number expected, got %s)", key, lua_tostring(L, index), lua_typename(L, type));
         break;
       }
-      int value = lua_tointeger(L, 2);
+      int value = lua_tointeger(L, index);
       context_set_int(context, key, value);
       break;
     }
     case META_ENTRY_TYPE_BOOLEAN: {
-      int value = lua_toboolean(L, 2);
+      int value = lua_toboolean(L, index);
       context_set_bool(context, key, value);
       break;
     }
     default:
       break;
   }
+}
+
+static int builtin_get(lua_State* L)
+{
+  Context* context = (Context*)lua_touserdata(L, lua_upvalueindex(1));
+  return push_config(L, context, luaL_checkstring(L, 1));
+}
+
+static int builtin_quit(lua_State* L)
+{
+  Context* context = (Context*)lua_touserdata(L, lua_upvalueindex(1));
+  gtk_window_close(context->layout.window);
+  return 0;
+}
+
+static int builtin_set(lua_State* L)
+{
+  Context* context = (Context*)lua_touserdata(L, lua_upvalueindex(1));
+  set_config(L, context, luaL_checkstring(L, 1), 2);
   return 0;
 }
 
@@ -161,46 +170,49 @@ static int builtin_set_config(lua_State* L)
   lua_pushnil(L);
   while (lua_next(L, -2)) {
     lua_pushvalue(L, -2);
-    const char* key = lua_tostring(L, -1);
-    MetaEntry* e = meta_get_entry(app->meta, key);
-    if (e) {
-      int type = lua_type(L, -2);
-      switch (e->type) {
-        case META_ENTRY_TYPE_STRING: {
-          const char* value = lua_tostring(L, -2);
-          if (!value) {
-            luaX_warn(L, "Invalid string config for '%s' (string expected, got %s)", key, lua_typename(L, type));
-            break;
-          }
-          context_set_str(context, key, value);
-          break;
-        }
-        case META_ENTRY_TYPE_INTEGER: {
-          if (type != LUA_TNUMBER) {
-            luaX_warn(L, "Invalid integer config for '%s': %s (number expected, got %s)", key, lua_tostring(L, -2), lua_typename(L, type));
-            break;
-          }
-          int value = lua_tointeger(L, -2);
-          context_set_int(context, key, value);
-          break;
-        }
-        case META_ENTRY_TYPE_BOOLEAN: {
-          int value = lua_toboolean(L, -2);
-          context_set_bool(context, key, value);
-          break;
-        }
-        default:
-          break;
-      }
-    } else {
-      luaX_warn(L, "Invalid config key: '%s'", key);
-    }
+    set_config(L, context, lua_tostring(L, -1), -2);
     lua_pop(L, 2);
   }
 
   return 0;
 }
 
+// `tym.config.key` reads and `tym.config.key = value` writes the one key, with
+// the same checks as `tym.get()` and `tym.set()`.
+static int config_index(lua_State* L)
+{
+  Context* context = (Context*)lua_touserdata(L, lua_upvalueindex(1));
+  return push_config(L, context, luaL_checkstring(L, 2));
+}
+
+static int config_newindex(lua_State* L)
+{
+  Context* context = (Context*)lua_touserdata(L, lua_upvalueindex(1));
+  set_config(L, context, luaL_checkstring(L, 2), 3);
+  return 0;
+}
+
+static void push_config_proxy(lua_State* L, Context* context)
+{
+  const luaL_Reg meta[] = {
+    { "__index"   , config_index    },
+    { "__newindex", config_newindex },
+    { NULL, NULL },
+  };
+  lua_newtable(L);
+  luaL_newlibtable(L, meta);
+  lua_pushlightuserdata(L, context);
+  luaL_setfuncs(L, meta, 1);
+  lua_setmetatable(L, -2);
+}
+
+static int builtin_get_config_generation(lua_State* L)
+{
+  Context* context = (Context*)lua_touserdata(L, lua_upvalueindex(1));
+  lua_pushinteger(L, context->config_generation);
+  return 1;
+}
+
 static int builtin_reset_config(lua_State* L)
 {
   Context* context = (Context*)lua_touserdata(L, lua_upvalueindex(1));
@@ -216,7 +228,7 @@ static int builtin_set_keymap(lua_State* L)
   luaL_argcheck(L, lua_isfunction(L, 2), 2, "function expected");
 
   int ref = luaL_ref(L, LUA_REGISTRYINDEX);
-  bool ok = keymap_add_entry(context->keymap, key, ref);
+  bool ok = keymap_add_entry(context->keymap, L, key, ref);
   if (!ok) {
     luaL_unref(L, LUA_REGISTRYINDEX, ref);
     luaX_warn(L, "Invalid accelerator: '%s'", key);
@@ -229,7 +241,7 @@ static int builtin_unset_keymap(lua_State* L)
 {
   Context* context = (Context*)lua_touserdata(L, lua_upvalueindex(1));
   const char* key = luaL_checkstring(L, 1);
-  bool removed = keymap_remove_entry(context->keymap, key);
+  bool removed = keymap_remove_entry(context->keymap, L, key);
   if (!removed) {
     luaX_warn(L, "Tried to remove en empty keymap '(%s') which is not assigned function to", key);
   }
@@ -251,7 +263,7 @@ static int builtin_set_keymaps(lua_State* L)
     } else {
       lua_pushvalue(L, -2); // push function to stack top
       int ref = luaL_ref(L, LUA_REGISTRYINDEX);
-      bool ok = keymap_add_entry(context->keymap, key, ref);
+      bool ok = keymap_add_entry(context->keymap, L, key, ref);
       if (!ok) {
         luaL_unref(L, LUA_REGISTRYINDEX, ref);
         luaX_warn(L, "Invalid accelerator: '%s'", key);
@@ -266,7 +278,7 @@ static int builtin_set_keymaps(lua_State* L)
 static int builtin_reset_keymaps(lua_State* L)
 {
   Context* context = (Context*)lua_touserdata(L, lua_upvalueindex(1));
-  keymap_reset(context->keymap);
+  keymap_reset(context->keymap, L);
   return 0;
 }
 
@@ -274,14 +286,16 @@ static int builtin_set_hook(lua_State* L)
 {
   Context* context = (Context*)lua_touserdata(L, lua_upvalueindex(1));
   const char* key = luaL_checkstring(L, 1);
-  luaL_argcheck(L, lua_isfunction(L, 2), 2, "function expected");
-  int ref = luaL_ref(L, LUA_REGISTRYINDEX);
+  luaL_argcheck(L, lua_isfunction(L, 2) || lua_isnoneornil(L, 2), 2, "function or nil expected");
+  // nil unsets the hook
+  int ref = lua_isfunction(L, 2) ? luaL_ref(L, LUA_REGISTRYINDEX) : LUA_NOREF;
   int old_ref = -1;
   if (hook_set_ref(context->hook, key, ref, &old_ref)) {
     if (old_ref > 0) {
       dd("unref old ref");
       luaL_unref(L, LUA_REGISTRYINDEX, old_ref);
     }
+    app_sync_hook_handlers(context);
     return 0;
   }
   luaL_unref(L, LUA_REGISTRYINDEX, ref);
@@ -315,6 +329,78 @@ static int builtin_set_hooks(lua_State* L)
     }
     lua_pop(L, 2);
   }
+  app_sync_hook_handlers(context);
+  return 0;
+}
+
+static TriggerAction get_trigger_action(lua_State* L, int index, bool* valid)
+{
+  *valid = true;
+  if (lua_isfunction(L, index)) {
+    return TRIGGER_ACTION_FUNCTION;
+  }
+  const char* name = lua_tostring(L, index);
+  if (is_equal(name, "notify")) {
+    return TRIGGER_ACTION_NOTIFY;
+  }
+  if (is_equal(name, "bell")) {
+    return TRIGGER_ACTION_BELL;
+  }
+  *valid = false;
+  return TRIGGER_ACTION_FUNCTION;
+}
+
+/* usage: tym.set_triggers({ { pattern = 'ERROR', action = 'notify' }, ... }) */
+static int builtin_set_triggers(lua_State* L)
+{
+  Context* context = (Context*)lua_touserdata(L, lua_upvalueindex(1));
+  Triggers* triggers = context->triggers;
+  if (triggers->scanning) {
+    luaX_warn(L, "Triggers can not be changed in a trigger function.");
+    return 0;
+  }
+  for (unsigned i = 0; i < triggers->items->len; i++) {
+    luaL_unref(L, LUA_REGISTRYINDEX, g_array_index(triggers->items, Trigger, i).ref);
+  }
+  triggers_clear(triggers);
+
+  if (!lua_isnoneornil(L, 1)) {
+    luaL_checktype(L, 1, LUA_TTABLE);
+#if USES_LUAJIT
+    size_t len = lua_objlen(L, 1);
+#else
+    size_t len = lua_rawlen(L, 1);
+#endif
+    for (size_t i = 1; i <= len; i++) {
+      lua_rawgeti(L, 1, i);
+      lua_getfield(L, -1, "pattern");
+      lua_getfield(L, -2, "action");
+      const char* pattern = lua_tostring(L, -2);
+      bool valid = false;
+      TriggerAction action = get_trigger_action(L, -1, &valid);
+      if (!pattern || !valid) {
+        luaX_warn(L, "Invalid trigger #%d: `pattern` string and `action` function, 'notify' or 'bell' are needed", (int)i);
+        lua_pop(L, 3);
+        continue;
+      }
+      int ref = LUA_NOREF;
+      if (action == TRIGGER_ACTION_FUNCTION) {
+        lua_pushvalue(L, -1);
+        ref = luaL_ref(L, LUA_REGISTRYINDEX);
+      }
+      char* error = triggers_add(triggers, pattern, action, ref);
+      if (error) {
+        luaX_warn(L, "Invalid trigger pattern '%s': %s", pattern, error);
+        luaL_unref(L, LUA_REGISTRYINDEX, ref);
+        g_free(error);
+      }
+      lua_pop(L, 3); // action, pattern, item
+    }
+    if (!triggers_build(triggers)) {
+      luaX_warn(L, "Failed to compile the trigger patterns together.");
+    }
+  }
+  app_sync_hook_handlers(context);
   return 0;
 }
 
@@ -344,30 +430,47 @@ static int builtin_send_key(lua_State* L)
     luaL_error(L, "Invalid accelerator: '%s'", accelerator);
     return 0;
   }
-  GdkEvent* event = gdk_event_new(GDK_KEY_PRESS);
-  if (context->device == NULL) {
-    g_warning("Could not get input device.");
-    return 0;
-  }
-  gdk_event_set_device(event, context->device);
-  event->key.window = g_object_ref(gtk_widget_get_window(GTK_WIDGET(context->layout.window)));
-  event->key.send_event = false;
-  event->key.time = GDK_CURRENT_TIME;
-  event->key.state = mod;
-  event->key.keyval = key;
-  gtk_main_do_event((GdkEvent*)event);
-  event->type = GDK_KEY_RELEASE;
-  gtk_main_do_event((GdkEvent*)event);
-  gdk_event_free((GdkEvent*)event);
+  context_send_key(context, key, mod);
   return 0;
 }
 
+static int builtin_macro_record(lua_State* L)
+{
+  Context* context = (Context*)lua_touserdata(L, lua_upvalueindex(1));
+  lua_pushboolean(L, macro_start(context->macro));
+  return 1;
+}
+
+static int builtin_macro_stop(lua_State* L)
+{
+  Context* context = (Context*)lua_touserdata(L, lua_upvalueindex(1));
+  lua_pushinteger(L, macro_stop(context->macro));
+  return 1;
+}
+
+static int builtin_macro_play(lua_State* L)
+{
+  Context* context = (Context*)lua_touserdata(L, lua_upvalueindex(1));
+  int count = luaL_optinteger(L, 1, 1);
+  luaL_argcheck(L, count >= 0, 1, "count must not be negative");
+  lua_pushboolean(L, context_play_macro(context, count));
+  return 1;
+}
+
+static int builtin_is_macro_recording(lua_State* L)
+{
+  Context* context = (Context*)lua_touserdata(L, lua_upvalueindex(1));
+  lua_pushboolean(L, macro_is_recording(context->macro));
+  return 1;
+}
+
 typedef struct {
   Context* context;
   int ref;
+  bool is_interval;
 } TimeoutCallbackNotation;
 
-static int timeout_callback(void* user_data)
+static bool timeout_callback(void* user_data)
 {
   TimeoutCallbackNotation* notation = (TimeoutCallbackNotation*)user_data;
 
@@ -379,45 +482,219 @@ static int timeout_callback(void* user_data)
     return false;
   }
 
-  if (lua_pcall(L, 0, 1, 0) != LUA_OK) {
+  Stats* stats = notation->context->stats;
+  gint64 started_at = stats_begin(stats);
+  int status = context_pcall(notation->context, 0, 1);
+  stats_end(stats, "timeout", NULL, started_at);
+  if (status != LUA_OK) {
     luaX_warn(L, "Error in timeout function: '%s'", lua_tostring(L, -1));
     lua_pop(L, 1); // error
     return false;
   }
   bool result = lua_toboolean(L, -1);
   lua_pop(L, 1);
-  return result;
+  // an interval keeps running until it is cleared
+  return notation->is_interval || result;
 }
 
-static int builtin_set_timeout(lua_State* L)
+static void timeout_destroy(void* user_data)
+{
+  TimeoutCallbackNotation* notation = (TimeoutCallbackNotation*)user_data;
+  luaL_unref(notation->context->lua, LUA_REGISTRYINDEX, notation->ref);
+  g_free(notation);
+}
+
+static int add_timer(lua_State* L, bool is_interval)
 {
   Context* context = (Context*)lua_touserdata(L, lua_upvalueindex(1));
 
   luaL_argcheck(L, lua_isfunction(L, 1), 1, "function expected");
   int interval = lua_tointeger(L, 2); // if non-number, falling back to 0
+  luaL_argcheck(L, interval >= 0, 2, "interval must not be negative");
 
   lua_pushvalue(L, 1);
   int ref = luaL_ref(L, LUA_REGISTRYINDEX);
   TimeoutCallbackNotation* notation = g_new0(TimeoutCallbackNotation, 1);
   notation->context = context;
   notation->ref = ref;
-  int tag = g_timeout_add_full(G_PRIORITY_DEFAULT, interval, (GSourceFunc)timeout_callback, notation, g_free);
-  lua_pushinteger(L, tag);
+  notation->is_interval = is_interval;
+  unsigned id = timer_add(app->timers, context, interval, timeout_callback, notation, timeout_destroy);
+  lua_pushinteger(L, id);
   return 1;
 }
 
+static int builtin_set_timeout(lua_State* L)
+{
+  return add_timer(L, false);
+}
+
+static int builtin_set_interval(lua_State* L)
+{
+  return add_timer(L, true);
+}
+
 static int builtin_clear_timeout(lua_State* L)
 {
-  int tag = luaL_checkinteger(L, 1);
-  g_source_remove(tag);
+  Context* context = (Context*)lua_touserdata(L, lua_upvalueindex(1));
+  int id = luaL_checkinteger(L, 1);
+  // timers of the other contexts can not be cleared
+  lua_pushboolean(L, id > 0 && timer_remove(app->timers, id, context));
+  return 1;
+}
+
+#define TYM_REGISTRY_TASKS "tym.tasks"
+
+/* A coroutine started by `tym.async()`. The thread is kept in a registry table
+ * while the task is alive, and the table maps it to the task so that the async
+ * builtins can tell a task from a coroutine of the script. An async builtin
+ * sets `pending` and yields, and then the operation resumes the task from the
+ * main loop. The operation owns the task while it is pending; if the context
+ * is closed in the meantime, it only frees the task. */
+typedef struct {
+  Context* context;
+  lua_State* thread;
+  bool pending;
+} Task;
+
+static void push_tasks(lua_State* L)
+{
+  lua_getfield(L, LUA_REGISTRYINDEX, TYM_REGISTRY_TASKS);
+  if (lua_isnil(L, -1)) {
+    lua_pop(L, 1);
+    lua_newtable(L);
+    lua_pushvalue(L, -1);
+    lua_setfield(L, LUA_REGISTRYINDEX, TYM_REGISTRY_TASKS);
+  }
+}
+
+// NULL unless `L` is the thread of a task
+static Task* get_current_task(lua_State* L)
+{
+  if (lua_pushthread(L)) {
+    lua_pop(L, 1); // main thread
+    return NULL;
+  }
+  push_tasks(L);
+  lua_pushvalue(L, -2);
+  lua_rawget(L, -2);
+  Task* task = (Task*)lua_touserdata(L, -1);
+  lua_pop(L, 3); // task, tasks, thread
+  return task;
+}
+
+static void task_finish(Task* task)
+{
+  lua_State* L = task->context->lua;
+  push_tasks(L);
+  lua_pushthread(task->thread);
+  lua_xmove(task->thread, L, 1);
+  lua_pushnil(L);
+  lua_rawset(L, -3);
+  lua_pop(L, 1); // tasks
+  task->context->tasks = g_list_remove(task->context->tasks, task);
+  g_free(task);
+}
+
+// The values to pass are pushed on the thread of the task.
+static void task_resume(Task* task, int narg)
+{
+  Context* context = task->context;
+  if (!context) {
+    g_free(task); // the context has gone
+    return;
+  }
+  task->pending = false;
+  int nres = 0;
+  int status = context_resume(context, task->thread, narg, &nres);
+  if (status == LUA_YIELD) {
+    lua_pop(task->thread, nres);
+    if (task->pending) {
+      return;
+    }
+    luaX_warn(context->lua, "Async function yielded without waiting for anything and was dropped.");
+  } else if (status != LUA_OK) {
+    luaX_warn(context->lua, "Error in async function: '%s'", lua_tostring(task->thread, -1));
+  }
+  task_finish(task);
+}
+
+static int task_wait(lua_State* L, Task* task)
+{
+  task->pending = true;
+  return lua_yield(L, 0);
+}
+
+void builtin_detach_tasks(Context* context)
+{
+  for (GList* li = context->tasks; li != NULL; li = li->next) {
+    ((Task*)li->data)->context = NULL;
+  }
+  g_list_free(context->tasks);
+  context->tasks = NULL;
+}
+
+/* usage: tym.async(function(...) end, ...) */
+static int builtin_async(lua_State* L)
+{
+  Context* context = (Context*)lua_touserdata(L, lua_upvalueindex(1));
+  luaL_argcheck(L, lua_isfunction(L, 1), 1, "function expected");
+  int narg = lua_gettop(L) - 1;
+
+  Task* task = g_new0(Task, 1);
+  task->context = context;
+  task->thread = lua_newthread(L);
+  push_tasks(L);
+  lua_pushvalue(L, -2);
+  lua_pushlightuserdata(L, task);
+  lua_rawset(L, -3);
+  lua_pop(L, 2); // tasks, thread
+  context->tasks = g_list_prepend(context->tasks, task);
+
+  lua_xmove(L, task->thread, narg + 1); // the function and the args
+  task_resume(task, narg);
   return 0;
 }
 
+static bool sleep_callback(void* user_data)
+{
+  task_resume((Task*)user_data, 0);
+  return false;
+}
+
+static int builtin_sleep(lua_State* L)
+{
+  int interval = luaL_checkinteger(L, 1);
+  Task* task = get_current_task(L);
+  if (!task) {
+    luaX_warn(L, "`tym.sleep()` is available only in `tym.async()`.");
+    return 0;
+  }
+  // No owner, so that the timer outlives the context and frees the task.
+  timer_add(app->timers, NULL, MAX(interval, 0), sleep_callback, task, NULL);
+  return task_wait(L, task);
+}
+
 static int builtin_put(lua_State* L)
 {
   Context* context = (Context*)lua_touserdata(L, lua_upvalueindex(1));
-  const char* text = luaL_checkstring(L, -1);
-  vte_terminal_feed_child(context->layout.vte, text, -1);
+  size_t len = 0;
+  const char* text = luaL_checklstring(L, -1, &len);
+  if (len > TYM_PASTE_CHUNK_SIZE || paste_is_active(context->paste)) {
+    // streamed, and kept after a paste going on
+    paste_append(context->paste, text, false);
+  } else {
+    vte_terminal_feed_child(context->layout.vte, text, -1);
+  }
+  return 0;
+}
+
+// As if the program printed it
+static int builtin_feed(lua_State* L)
+{
+  Context* context = (Context*)lua_touserdata(L, lua_upvalueindex(1));
+  size_t len = 0;
+  const char* text = luaL_checklstring(L, 1, &len);
+  vte_terminal_feed(context->layout.vte, text, len);
   return 0;
 }
 
@@ -495,26 +772,55 @@ static int builtin_paste(lua_State* L)
   Context* context = (Context*)lua_touserdata(L, lua_upvalueindex(1));
 
   const char* target = lua_tostring(L, 1);
-  if (!target || is_equal(target, TYM_CLIPBOARD_CLIPBOARD)) {
-    command_paste(context);
-    return 0;
-  }
   GdkAtom selection = GDK_SELECTION_CLIPBOARD;
   if (is_equal(target, TYM_CLIPBOARD_PRIMARY)) {
     selection = GDK_SELECTION_PRIMARY;
   } else if (is_equal(target, TYM_CLIPBOARD_SECONDARY)) {
     selection = GDK_SELECTION_SECONDARY;
-  } else {
+  } else if (target && !is_equal(target, TYM_CLIPBOARD_CLIPBOARD)) {
     luaX_warn(L, "Invalid target(`%s`): 'clipboard', 'primary' or 'secondary' is available.", target);
     return 0;
   }
-  GtkClipboard* cb = gtk_clipboard_get(selection);
-  char* text = gtk_clipboard_wait_for_text(cb);
-  vte_terminal_feed_child(context->layout.vte, text, -1);
-  g_free(text);
+
+  // Without options, VTE pastes it, bracketing it as the program has asked
+  if (!lua_istable(L, 2)) {
+    if (selection == GDK_SELECTION_CLIPBOARD) {
+      command_paste(context);
+      return 0;
+    }
+    if (selection == GDK_SELECTION_PRIMARY) {
+      vte_terminal_paste_primary(context->layout.vte);
+      return 0;
+    }
+  }
+  bool bracketed = false;
+  if (lua_istable(L, 2)) {
+    lua_getfield(L, 2, "bracketed");
+    bracketed = lua_toboolean(L, -1);
+    lua_pop(L, 1);
+  }
+  paste_request(context->paste, selection, bracketed);
   return 0;
 }
 
+static int builtin_get_paste_progress(lua_State* L)
+{
+  Context* context = (Context*)lua_touserdata(L, lua_upvalueindex(1));
+  size_t written = 0;
+  size_t total = 0;
+  paste_get_progress(context->paste, &written, &total);
+  lua_pushinteger(L, written);
+  lua_pushinteger(L, total);
+  return 2;
+}
+
+static int builtin_cancel_paste(lua_State* L)
+{
+  Context* context = (Context*)lua_touserdata(L, lua_upvalueindex(1));
+  lua_pushboolean(L, paste_cancel(context->paste));
+  return 1;
+}
+
 static int builtin_color_to_rgba(lua_State* L)
 {
   GdkRGBA color;
@@ -573,23 +879,12 @@ static int builtin_hex_to_rgb(lua_State* L)
 static GVariant* table_to_variant(lua_State* L, int table_index)
 {
   luaL_argcheck(L, lua_istable(L, table_index), table_index, "table expected");
-
-#if USES_LUAJIT
-  size_t num_params = lua_objlen(L, table_index);
-#else
-  size_t num_params = lua_rawlen(L, table_index);
-#endif
-  GVariant** vv = g_new0(GVariant*, num_params);
-  int i = 0;
-  while (i < num_params) {
-    lua_rawgeti(L, table_index, i + 1); // args[table_index][i+1]
-    vv[i] = g_variant_new_string(lua_tostring(L, -1));
-    lua_pop(L, 1);
-    i += 1;
+  const char* error = NULL;
+  GVariant* params = variant_tuple_from_lua(L, table_index, &error);
+  if (!params) {
+    luaL_argerror(L, table_index, error);
   }
-  GVariant* p = g_variant_new_tuple(vv, num_params);
-  g_free(vv);
-  return p;
+  return params;
 }
 
 /* usage tym.signal(0, 'hook', {'param'}) */
@@ -620,33 +915,10 @@ typedef struct {
   int ref;
 } CallCallbackNotation;
 
-void push_value_by_gvariant(lua_State* L, GVariant* v) {
-  if (g_variant_is_of_type(v, G_VARIANT_TYPE_INT32)) {
-    lua_pushinteger(L, g_variant_get_int32(v));
-  } else if (g_variant_is_of_type(v, G_VARIANT_TYPE_STRING)) {
-    char* s = NULL;
-    g_variant_get(v, "s", &s);
-    lua_pushstring(L, s);
-    g_free(s);
-  } else if (g_variant_is_of_type(v, G_VARIANT_TYPE_ARRAY) || g_variant_is_of_type(v, G_VARIANT_TYPE_TUPLE)) {
-    lua_newtable(L);
-    size_t num = g_variant_n_children(v);
-    int i = 0;
-    while (i < num) {
-      GVariant* e = g_variant_get_child_value(v, i);
-      push_value_by_gvariant(L, e);
-      lua_rawseti(L, -2, i + 1);
-      i += 1;
-    }
-  } else {
-    lua_pushstring(L, g_variant_print(v, false));
-  }
-}
-
 void call_callback(GObject* source_object, GAsyncResult* res, void* user_data)
 {
   GError* error = NULL;
-  TimeoutCallbackNotation* notation = (TimeoutCallbackNotation*)user_data;
+  CallCallbackNotation* notation = (CallCallbackNotation*)user_data;
   Context* context = notation->context;
   lua_State* L = context->lua;
 
@@ -654,9 +926,15 @@ void call_callback(GObject* source_object, GAsyncResult* res, void* user_data)
   GVariant* result = g_dbus_connection_call_finish(conn, res, &error);
 
   lua_rawgeti(L, LUA_REGISTRYINDEX, notation->ref);
+  luaL_unref(L, LUA_REGISTRYINDEX, notation->ref);
+  g_free(notation);
   if (!lua_isfunction(L, -1)) {
     lua_pop(L, 1); // pop none-function
     context_log_warn(context, true, "tried to call non-function");
+    if (result) {
+      g_variant_unref(result);
+    }
+    g_clear_error(&error);
     return;
   }
 
@@ -669,24 +947,52 @@ void call_callback(GObject* source_object, GAsyncResult* res, void* user_data)
     g_free(m);
     num_args = 1;
   } else {
-    dd("DBus method call result: `%s`", g_variant_print(result, true));
-    int num_result = g_variant_n_children(result);
-    int i = 0;
-    while (i < num_result) {
-      GVariant* e = g_variant_get_child_value(result, i);
-      push_value_by_gvariant(L, e);
-      i += 1;
-    }
-    num_args = num_result;
+    num_args = variant_push_children(L, result);
+    g_variant_unref(result);
   }
 
-  if (lua_pcall(L, num_args, 0, 0) != LUA_OK) {
+  gint64 started_at = stats_begin(context->stats);
+  int status = context_pcall(context, num_args, 0);
+  stats_end(context->stats, "call", NULL, started_at);
+  if (status != LUA_OK) {
     luaX_warn(L, "Error in timeout function: '%s'", lua_tostring(L, -1));
     lua_pop(L, 1); // error
   }
 }
 
-/* usage: tym.call(0, 'eval', {'return 1+2'}, function(...) end) */
+// Resumes the task with the results, or nil and the message on error.
+static void call_task_callback(GObject* source_object, GAsyncResult* res, void* user_data)
+{
+  GError* error = NULL;
+  Task* task = (Task*)user_data;
+
+  GDBusConnection* conn = G_DBUS_CONNECTION(source_object);
+  GVariant* result = g_dbus_connection_call_finish(conn, res, &error);
+  if (!task->context) {
+    if (result) {
+      g_variant_unref(result);
+    }
+    g_clear_error(&error);
+    task_resume(task, 0);
+    return;
+  }
+
+  lua_State* T = task->thread;
+  int num_args = 0;
+  if (error) {
+    lua_pushnil(T);
+    lua_pushfstring(T, "DBus error: '%s'", error->message);
+    g_error_free(error);
+    num_args = 2;
+  } else {
+    num_args = variant_push_children(T, result);
+    g_variant_unref(result);
+  }
+  task_resume(task, num_args);
+}
+
+/* usage: tym.call(0, 'eval', {'return 1+2'}, function(...) end)
+ * or in tym.async(): local v = tym.call(0, 'eval', {'return 1+2'}) */
 static int builtin_call(lua_State* L)
 {
   Context* context = (Context*)lua_touserdata(L, lua_upvalueindex(1));
@@ -695,16 +1001,21 @@ static int builtin_call(lua_State* L)
   GVariant* params = table_to_variant(L, 3);
 
   bool has_cb = lua_gettop(L) >= 4;
+  Task* task = has_cb ? NULL : get_current_task(L);
 
-  CallCallbackNotation* notation = NULL;
+  void* notation = NULL;
   GAsyncReadyCallback cb = NULL;
-  if (has_cb) {
+  if (task) {
+    notation = task;
+    cb = (GAsyncReadyCallback)call_task_callback;
+  } else if (has_cb) {
     luaL_argcheck(L, lua_isfunction(L, 4), 4, "function expected");
     lua_pushvalue(L, 4);
     int ref = luaL_ref(L, LUA_REGISTRYINDEX);
-    notation = g_new0(CallCallbackNotation, 1);
-    notation->context = context;
-    notation->ref = ref;
+    CallCallbackNotation* n = g_new0(CallCallbackNotation, 1);
+    n->context = context;
+    n->ref = ref;
+    notation = n;
     cb = (GAsyncReadyCallback)call_callback;
   }
 
@@ -726,6 +1037,9 @@ static int builtin_call(lua_State* L)
       notation     // user_data
   );
   g_free(object_path);
+  if (task) {
+    return task_wait(L, task);
+  }
   return 0;
 }
 
@@ -753,6 +1067,43 @@ static int builtin_get_cursor_position(lua_State* L)
   return 2;
 }
 
+static void clipboard_task_callback(GtkClipboard* clipboard, const char* text, void* user_data)
+{
+  Task* task = (Task*)user_data;
+  if (!task->context) {
+    task_resume(task, 0);
+    return;
+  }
+  lua_pushstring(task->thread, text);
+  task_resume(task, 1);
+}
+
+static void run_task_callback(GObject* source_object, GAsyncResult* res, void* user_data)
+{
+  GSubprocess* process = G_SUBPROCESS(source_object);
+  Task* task = (Task*)user_data;
+  GError* error = NULL;
+  char* out = NULL;
+  char* err = NULL;
+  bool ok = g_subprocess_communicate_utf8_finish(process, res, &out, &err, &error);
+  if (!task->context) {
+    g_clear_error(&error);
+    task_resume(task, 0);
+  } else if (!ok) {
+    lua_pushnil(task->thread);
+    lua_pushstring(task->thread, error->message);
+    g_error_free(error);
+    task_resume(task, 2);
+  } else {
+    lua_pushstring(task->thread, out);
+    lua_pushstring(task->thread, err);
+    lua_pushinteger(task->thread, g_subprocess_get_if_exited(process) ? g_subprocess_get_exit_status(process) : -1);
+    task_resume(task, 3);
+  }
+  g_free(out);
+  g_free(err);
+}
+
 static int builtin_get_clipboard(lua_State* L)
 {
   const char* target = lua_tostring(L, 1);
@@ -767,12 +1118,71 @@ static int builtin_get_clipboard(lua_State* L)
     return 0;
   }
   GtkClipboard* cb = gtk_clipboard_get(selection);
+  Task* task = get_current_task(L);
+  if (task) {
+    gtk_clipboard_request_text(cb, clipboard_task_callback, task);
+    return task_wait(L, task);
+  }
   char* text = gtk_clipboard_wait_for_text(cb);
   lua_pushstring(L, text);
   g_free(text);
   return 1;
 }
 
+// Runs a command and returns stdout, stderr and the exit status.
+/* usage: in tym.async(): local out, err, status = tym.run({'git', 'status'}) */
+static int builtin_run(lua_State* L)
+{
+  char** argv = NULL;
+  GError* error = NULL;
+  if (lua_istable(L, 1)) {
+#if USES_LUAJIT
+    size_t len = lua_objlen(L, 1);
+#else
+    size_t len = lua_rawlen(L, 1);
+#endif
+    argv = g_new0(char*, len + 1);
+    for (size_t i = 0; i < len; i++) {
+      lua_rawgeti(L, 1, i + 1);
+      argv[i] = g_strdup(lua_tostring(L, -1));
+      lua_pop(L, 1);
+      if (!argv[i]) {
+        g_strfreev(argv);
+        return luaL_argerror(L, 1, "strings expected");
+      }
+    }
+  } else if (!g_shell_parse_argv(luaL_checkstring(L, 1), NULL, &argv, &error)) {
+    lua_pushnil(L);
+    lua_pushstring(L, error ? error->message : "could not parse the command line");
+    g_clear_error(&error);
+    return 2;
+  }
+  if (!argv[0] || !*argv[0]) {
+    g_strfreev(argv);
+    return luaL_argerror(L, 1, "program name expected");
+  }
+  Task* task = get_current_task(L);
+  if (!task) {
+    g_strfreev(argv);
+    luaX_warn(L, "`tym.run()` is available only in `tym.async()`.");
+    return 0;
+  }
+  GSubprocess* process = g_subprocess_newv(
+    (const char* const*)argv,
+    G_SUBPROCESS_FLAGS_STDOUT_PIPE | G_SUBPROCESS_FLAGS_STDERR_PIPE,
+    &error);
+  g_strfreev(argv);
+  if (!process) {
+    lua_pushnil(L);
+    lua_pushstring(L, error ? error->message : "could not spawn the process");
+    g_clear_error(&error);
+    return 2;
+  }
+  g_subprocess_communicate_utf8_async(process, NULL, NULL, run_task_callback, task);
+  g_object_unref(process); // the async operation holds a ref
+  return task_wait(L, task);
+}
+
 static int builtin_get_selection(lua_State* L)
 {
   GtkClipboard* cb = gtk_clipboard_get(GDK_SELECTION_PRIMARY);
@@ -822,6 +1232,90 @@ static int builtin_get_text(lua_State* L)
   return 1;
 }
 
+#define TYM_SCREEN_METATABLE "tym.screen"
+
+static Screen* check_screen(lua_State* L, int index)
+{
+  Screen** ud = (Screen**)luaL_checkudata(L, index, TYM_SCREEN_METATABLE);
+  return *ud;
+}
+
+static int screen_is_wrapped_method(lua_State* L)
+{
+  Screen* screen = check_screen(L, 1);
+  int row = luaL_checkinteger(L, 2);
+  lua_pushboolean(L, row > 0 && screen_is_wrapped(screen, row - 1));
+  return 1;
+}
+
+// screen[i] is the text of the i-th row, and the others are looked up in the methods.
+static int screen_index(lua_State* L)
+{
+  Screen* screen = check_screen(L, 1);
+  if (lua_type(L, 2) == LUA_TNUMBER) {
+    int row = lua_tointeger(L, 2);
+    size_t length = 0;
+    const char* text = row > 0 ? screen_get_row(screen, row - 1, &length) : NULL;
+    if (text) {
+      lua_pushlstring(L, text, length);
+    } else {
+      lua_pushnil(L);
+    }
+    return 1;
+  }
+  lua_getmetatable(L, 1);
+  lua_getfield(L, -1, "methods");
+  lua_pushvalue(L, 2);
+  lua_rawget(L, -2);
+  return 1;
+}
+
+static int screen_len(lua_State* L)
+{
+  lua_pushinteger(L, screen_get_row_count(check_screen(L, 1)));
+  return 1;
+}
+
+static int screen_gc(lua_State* L)
+{
+  Screen** ud = (Screen**)luaL_checkudata(L, 1, TYM_SCREEN_METATABLE);
+  if (*ud) {
+    screen_close(*ud);
+    *ud = NULL;
+  }
+  return 0;
+}
+
+/* usage: local s = tym.get_screen(); for i = 1, #s do print(s[i], s:is_wrapped(i)) end */
+static int builtin_get_screen(lua_State* L)
+{
+  Context* context = (Context*)lua_touserdata(L, lua_upvalueindex(1));
+  Screen* screen = screen_init(context->layout.vte);
+  if (!screen) {
+    return 0;
+  }
+  Screen** ud = (Screen**)lua_newuserdata(L, sizeof(Screen*));
+  *ud = screen;
+  if (luaL_newmetatable(L, TYM_SCREEN_METATABLE)) {
+    const luaL_Reg meta[] = {
+      { "__index", screen_index },
+      { "__len"  , screen_len   },
+      { "__gc"   , screen_gc    },
+      { NULL, NULL },
+    };
+    const luaL_Reg methods[] = {
+      { "is_wrapped", screen_is_wrapped_method },
+      { NULL, NULL },
+    };
+    luaL_setfuncs(L, meta, 0);
+    luaL_newlibtable(L, methods);
+    luaL_setfuncs(L, methods, 0);
+    lua_setfield(L, -2, "methods");
+  }
+  lua_setmetatable(L, -2);
+  return 1;
+}
+
 static int builtin_get_monitor_model(lua_State* L)
 {
   Context* context = (Context*)lua_touserdata(L, lua_upvalueindex(1));
@@ -862,17 +1356,44 @@ static int builtin_get_id(lua_State* L)
 
 static int builtin_get_ids(lua_State* L)
 {
-  lua_newtable(L);
-  int i = 0;
-  for (GList* li = app->contexts; li != NULL; li = li->next) {
-    Context* c = (Context*)li->data;
-    lua_pushinteger(L, c->id);
+  GArray* ids = registry_get_ids(app->contexts);
+  lua_createtable(L, ids->len, 0);
+  for (unsigned i = 0; i < ids->len; i++) {
+    lua_pushinteger(L, g_array_index(ids, int, i));
     lua_rawseti(L, -2, i + 1);
-    i += 1;
+  }
+  g_array_unref(ids);
+  return 1;
+}
+
+static int builtin_get_stats(lua_State* L)
+{
+  Context* context = (Context*)lua_touserdata(L, lua_upvalueindex(1));
+  lua_newtable(L);
+  GHashTableIter iter;
+  const char* name = NULL;
+  StatsEntry* e = NULL;
+  g_hash_table_iter_init(&iter, context->stats->entries);
+  while (g_hash_table_iter_next(&iter, (void**)&name, (void**)&e)) {
+    lua_createtable(L, 0, 3);
+    lua_pushinteger(L, e->count);
+    lua_setfield(L, -2, "count");
+    lua_pushnumber(L, e->total / 1000.0);
+    lua_setfield(L, -2, "total");
+    lua_pushnumber(L, e->max / 1000.0);
+    lua_setfield(L, -2, "max");
+    lua_setfield(L, -2, name);
   }
   return 1;
 }
 
+static int builtin_reset_stats(lua_State* L)
+{
+  Context* context = (Context*)lua_touserdata(L, lua_upvalueindex(1));
+  stats_reset(context->stats);
+  return 0;
+}
+
 static int builtin_get_object_path(lua_State* L)
 {
   Context* context = (Context*)lua_touserdata(L, lua_upvalueindex(1));
@@ -899,6 +1420,13 @@ static int builtin_get_version(lua_State* L)
   return 1;
 }
 
+// Milliseconds of the monotonic clock, for measuring wall-clock time
+static int builtin_get_monotonic_time(lua_State* L)
+{
+  lua_pushnumber(L, g_get_monotonic_time() / 1000.0);
+  return 1;
+}
+
 static int builtin_apply(lua_State* L)
 {
   Context* context = (Context*)lua_touserdata(L, lua_upvalueindex(1));
@@ -918,24 +1446,38 @@ int builtin_register_module(lua_State* L)
     { "get_config"          , builtin_get_config           },
     { "set_config"          , builtin_set_config           },
     { "reset_config"        , builtin_reset_config         },
+    { "get_config_generation", builtin_get_config_generation },
     { "set_keymap"          , builtin_set_keymap           },
     { "unset_keymap"        , builtin_unset_keymap         },
     { "set_keymaps"         , builtin_set_keymaps          },
     { "reset_keymaps"       , builtin_reset_keymaps        },
     { "set_hook"            , builtin_set_hook             },
     { "set_hooks"           , builtin_set_hooks            },
+    { "set_triggers"        , builtin_set_triggers         },
     { "reload"              , builtin_reload               },
     { "reload_theme"        , builtin_reload_theme         },
     { "send_key"            , builtin_send_key             },
+    { "macro_record"        , builtin_macro_record         },
+    { "macro_stop"          , builtin_macro_stop           },
+    { "macro_play"          , builtin_macro_play           },
+    { "is_macro_recording"  , builtin_is_macro_recording   },
+    { "async"               , builtin_async                },
+    { "sleep"               , builtin_sleep                },
+    { "run"                 , builtin_run                  },
     { "set_timeout"         , builtin_set_timeout          },
+    { "set_interval"        , builtin_set_interval         },
     { "clear_timeout"       , builtin_clear_timeout        },
+    { "clear_interval"      , builtin_clear_timeout        },
     { "put"                 , builtin_put                  },
+    { "feed"                , builtin_feed                 },
     { "bell"                , builtin_bell                 },
     { "open"                , builtin_open                 },
     { "notify"              , builtin_notify               },
     { "copy"                , builtin_copy                 },
     { "copy_selection"      , builtin_copy_selection       },
     { "paste"               , builtin_paste                },
+    { "get_paste_progress"  , builtin_get_paste_progress   },
+    { "cancel_paste"        , builtin_cancel_paste         },
     { "check_mod_state"     , builtin_check_mod_state      },
     { "color_to_rgba"       , builtin_color_to_rgba        },
     { "rgba_to_color"       , builtin_rgba_to_color        },
@@ -951,14 +1493,18 @@ int builtin_register_module(lua_State* L)
     { "select_all"          , builtin_select_all           },
     { "has_selection"       , builtin_has_selection        },
     { "get_text"            , builtin_get_text             },
+    { "get_screen"          , builtin_get_screen           },
     { "get_config_path"     , builtin_get_config_path      },
     { "get_theme_path"      , builtin_get_theme_path       },
     { "get_id"              , builtin_get_id               },
     { "get_ids"             , builtin_get_ids              },
+    { "get_stats"           , builtin_get_stats            },
+    { "reset_stats"         , builtin_reset_stats          },
     { "get_object_path"     , builtin_get_object_path      },
     { "get_terminal_pid"    , builtin_get_terminal_pid     },
     { "get_pid"             , builtin_get_pid              },
     { "get_version"         , builtin_get_version          },
+    { "get_monotonic_time"  , builtin_get_monotonic_time   },
     // DEPRECATED
     { "apply"               , builtin_apply                },
     { NULL, NULL },
@@ -968,5 +1514,8 @@ int builtin_register_module(lua_State* L)
   luaL_newlibtable(L, table);
   lua_pushlightuserdata(L, context);
   luaL_setfuncs(L, table, 1);
+  push_config_proxy(L, context);
+  lua_setfield(L, -2, "config");
+  tym_ffi_register(L, context);
   return 1;
 }
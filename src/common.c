@@ -102,6 +102,17 @@ char* tym_get_visible_text(VteTerminal* vte)
 #endif
 }
 
+char* tym_get_selected_text(VteTerminal* vte)
+{
+#ifdef TYM_USE_VTE_GET_TEXT_SELECTED
+  return vte_terminal_get_text_selected(vte, VTE_FORMAT_TEXT);
+#else
+  /* Older VTE can only hand the selection over as PRIMARY */
+  GtkClipboard* cb = gtk_clipboard_get(GDK_SELECTION_PRIMARY);
+  return gtk_clipboard_wait_for_text(cb);
+#endif
+}
+
 void luaX_requirec(lua_State* L, const char* modname, lua_CFunction openf, int glb, void* userdata)
 {
 #if USES_LUAJIT
@@ -138,3 +149,19 @@ int luaX_warn(lua_State* L, const char* fmt, ...)
   lua_pop(L, 1);
   return 0;
 }
+
+int luaX_resume(lua_State* L, lua_State* from, int narg, int* nres)
+{
+#if LUA_VERSION_NUM >= 504
+  return lua_resume(L, from, narg, nres);
+#else
+#if LUA_VERSION_NUM >= 502
+  int status = lua_resume(L, from, narg);
+#else
+  int status = lua_resume(L, narg);
+#endif
+  /* the stack of the coroutine holds only the yielded or returned values */
+  *nres = lua_gettop(L);
+  return status;
+#endif
+}
@@ -23,7 +23,12 @@ typedef struct {
 } KeyPair;
 
 #define TYM_MODULE_NAME "tym"
+#define TYM_REGISTRY_CONTEXT "tym.context"
+// How many VM instructions run between checks of the Lua timeout
+#define TYM_LUA_TIMEOUT_CHECK_COUNT 1000
 #define TYM_DEFAULT_NOTIFICATION_TITLE "tym"
+// Enough for the object path and the handler tags of a window in one chunk
+#define TYM_CONTEXT_ARENA_CHUNK_SIZE 1024
 
 static KeyPair DEFAULT_KEY_PAIRS[] = {
   { GDK_KEY_c , GDK_CONTROL_MASK | GDK_SHIFT_MASK, command_copy_selection },
@@ -52,7 +57,6 @@ char* context_acquire_config_path(Context* context)
   char* cwd = g_get_current_dir();
   char* abs_path = g_build_path(G_DIR_SEPARATOR_S, cwd, path, NULL);
   g_free(cwd);
-  g_free(path);
   return abs_path;
 }
 
@@ -75,19 +79,169 @@ char* context_acquire_theme_path(Context* context)
   char* cwd = g_get_current_dir();
   char* abs_path = g_build_path(G_DIR_SEPARATOR_S, cwd, path, NULL);
   g_free(cwd);
-  g_free(path);
   return abs_path;
 }
 
+static void wrap_coroutine_library(lua_State* L);
+
 void context_load_lua_context(Context* context)
 {
   lua_State* L = luaL_newstate();
   luaL_openlibs(L);
+  wrap_coroutine_library(L);
   luaX_requirec(L, TYM_MODULE_NAME, builtin_register_module, true, context);
   lua_pop(L, 1);
+  lua_pushlightuserdata(L, context);
+  lua_setfield(L, LUA_REGISTRYINDEX, TYM_REGISTRY_CONTEXT);
   context->lua = L;
 }
 
+Context* context_from_lua(lua_State* L)
+{
+  lua_getfield(L, LUA_REGISTRYINDEX, TYM_REGISTRY_CONTEXT);
+  Context* context = (Context*)lua_touserdata(L, -1);
+  lua_pop(L, 1);
+  return context;
+}
+
+/* All the contexts share the main loop, so a callback which never returns
+ * freezes every window. While `lua_timeout` is set, callbacks run with a count
+ * hook which raises an error once the deadline has passed. After that the hook
+ * fires on every instruction, so that `pcall()` in the script cannot swallow
+ * the error and keep going. Nested calls run under the outermost deadline. */
+static gint64 lua_deadline = 0;
+static bool lua_deadline_exceeded = false;
+
+static void on_lua_count(lua_State* L, lua_Debug* ar)
+{
+  if (g_get_monotonic_time() < lua_deadline) {
+    return;
+  }
+  lua_deadline_exceeded = true;
+  lua_sethook(L, on_lua_count, LUA_MASKCOUNT, 1);
+  luaL_error(L, "Aborted since it ran over lua_timeout");
+}
+
+// A hook set with `debug.sethook()` is put back once the deadline is over.
+typedef struct {
+  lua_Hook func;
+  int mask;
+  int count;
+} SavedHook;
+
+static SavedHook arm_deadline_hook(lua_State* L)
+{
+  SavedHook saved = { lua_gethook(L), lua_gethookmask(L), lua_gethookcount(L) };
+  lua_sethook(L, on_lua_count, LUA_MASKCOUNT, TYM_LUA_TIMEOUT_CHECK_COUNT);
+  return saved;
+}
+
+static void restore_hook(lua_State* L, SavedHook saved)
+{
+  lua_sethook(L, saved.func, saved.mask, saved.count);
+}
+
+// A coroutine takes the hook of the thread creating it, so one created before
+// the deadline was armed would run unchecked. `coroutine.resume()` and the
+// functions from `coroutine.wrap()` arm it on the coroutine while resumed.
+static int resume_with_deadline(lua_State* L)
+{
+  lua_State* co = lua_tothread(L, 1);
+  bool armed = co && lua_deadline;
+  SavedHook saved;
+  if (armed) {
+    saved = arm_deadline_hook(co);
+  }
+  lua_pushvalue(L, lua_upvalueindex(1));
+  lua_insert(L, 1);
+  lua_call(L, lua_gettop(L) - 1, LUA_MULTRET);
+  if (armed) {
+    restore_hook(co, saved);
+  }
+  return lua_gettop(L);
+}
+
+static int resume_wrapped(lua_State* L)
+{
+  lua_pushvalue(L, lua_upvalueindex(1));
+  lua_insert(L, 1);
+  lua_pushvalue(L, lua_upvalueindex(2));
+  lua_insert(L, 2);
+  lua_call(L, lua_gettop(L) - 1, LUA_MULTRET);
+  if (!lua_toboolean(L, 1)) {
+    lua_pushvalue(L, 2);
+    return lua_error(L);
+  }
+  return lua_gettop(L) - 1;
+}
+
+static int wrap_with_deadline(lua_State* L)
+{
+  luaL_checktype(L, 1, LUA_TFUNCTION);
+  lua_pushvalue(L, lua_upvalueindex(1));
+  lua_State* co = lua_newthread(L);
+  lua_pushvalue(L, 1);
+  lua_xmove(L, co, 1);
+  lua_pushcclosure(L, resume_wrapped, 2);
+  return 1;
+}
+
+static void wrap_coroutine_library(lua_State* L)
+{
+  lua_getglobal(L, "coroutine");
+  lua_getfield(L, -1, "resume");
+  lua_pushcclosure(L, resume_with_deadline, 1);
+  lua_pushvalue(L, -1);
+  lua_setfield(L, -3, "resume");
+  lua_pushcclosure(L, wrap_with_deadline, 1);
+  lua_setfield(L, -2, "wrap");
+  lua_pop(L, 1);
+}
+
+int context_pcall(Context* context, int narg, int nresult)
+{
+  lua_State* L = context->lua;
+  if (context->lua_timeout <= 0 || lua_deadline) {
+    return lua_pcall(L, narg, nresult, 0);
+  }
+  lua_deadline = g_get_monotonic_time() + (gint64)context->lua_timeout * 1000;
+  lua_deadline_exceeded = false;
+  SavedHook saved = arm_deadline_hook(L);
+  int status = lua_pcall(L, narg, nresult, 0);
+  restore_hook(L, saved);
+  lua_deadline = 0;
+  if (lua_deadline_exceeded) {
+    context_log_warn(context, true, "A Lua callback ran over %d ms and was aborted.", context->lua_timeout);
+  }
+  return status;
+}
+
+// Same as `context_pcall()` for a coroutine. The hook is set on the coroutine
+// since every Lua thread has a hook of its own.
+int context_resume(Context* context, lua_State* thread, int narg, int* nres)
+{
+  if (context->lua_timeout <= 0) {
+    return luaX_resume(thread, context->lua, narg, nres);
+  }
+  bool outermost = !lua_deadline;
+  if (outermost) {
+    lua_deadline = g_get_monotonic_time() + (gint64)context->lua_timeout * 1000;
+    lua_deadline_exceeded = false;
+  }
+  SavedHook saved = arm_deadline_hook(thread);
+  int status = luaX_resume(thread, context->lua, narg, nres);
+  restore_hook(thread, saved);
+  if (outermost) {
+    lua_deadline = 0;
+    if (lua_deadline_exceeded) {
+      context_log_warn(context, true, "A Lua callback ran over %d ms and was aborted.", context->lua_timeout);
+    }
+  }
+  return status;
+}
+
+static void on_keymap_expired(KeymapNode* node, void* user_data);
+
 Context* context_init(int id, Option* option)
 {
   dd("init context id=%d", id);
@@ -97,39 +251,90 @@ Context* context_init(int id, Option* option)
   context->option = option;
   context->config_loading = false;
   context->initialized = false;
-  context->object_path = g_strdup_printf(TYM_OBJECT_PATH_FMT_INT, context->id);
+  context->arena = arena_init(TYM_CONTEXT_ARENA_CHUNK_SIZE);
+  context->object_path = arena_strdup_printf(context->arena, TYM_OBJECT_PATH_FMT_INT, context->id);
   context->child_pid = -1;
   context->config = config_init();
   context->keymap = keymap_init();
-  context->hook = hook_init();
+  keymap_set_expire_func(context->keymap, on_keymap_expired, context);
+  for (KeyPair* pair = DEFAULT_KEY_PAIRS; pair->func; pair++) {
+    keymap_set_default(context->keymap, pair->key, pair->mod, pair);
+  }
+  context->macro = macro_init();
+  context->stats = stats_init();
+  context->hook = hook_init(context->stats);
+  context->triggers = triggers_init();
   return context;
 }
 
 void context_close(Context* context)
 {
   dd("close context id=%d", context->id);
-  for (GList* li = context->handler_tags; li != NULL; li = li->next) {
-    HandlerTag* tag = (HandlerTag*)li->data;
-    g_signal_handler_disconnect(tag->object, tag->handler_id);
+  // the handlers are connected to the widgets; without a layout there is
+  // nothing to disconnect from, as when a context is used alone in the tests
+  if (context->layout.window) {
+    for (HandlerTag* tag = context->handler_tags; tag != NULL; tag = tag->next) {
+      g_signal_handler_disconnect(tag->object, tag->handler_id);
+    }
+  }
+  for (int i = 0; i < HOOK_HANDLER_COUNT; i++) {
+    HandlerTag* tag = &context->hook_handlers[i];
+    if (tag->handler_id) {
+      g_signal_handler_disconnect(tag->object, tag->handler_id);
+    }
+  }
+  if (context->scroll.tick_id) {
+    gtk_widget_remove_tick_callback(GTK_WIDGET(context->layout.vte), context->scroll.tick_id);
+  }
+  if (context->selection_tag) {
+    g_source_remove(context->selection_tag);
+  }
+  if (context->selection_waiter) {
+    *context->selection_waiter = NULL;
+  }
+  if (context->title_tag) {
+    g_source_remove(context->title_tag);
+  }
+  if (context->output.tag) {
+    g_source_remove(context->output.tag);
+  }
+  if (context->resize_tick_id) {
+    gtk_widget_remove_tick_callback(GTK_WIDGET(context->layout.window), context->resize_tick_id);
+  }
+  // before closing Lua since the timers release their refs. There is no app
+  // when the context is used alone as in the tests.
+  if (app) {
+    timer_remove_by_owner(app->timers, context);
+  }
+  builtin_detach_tasks(context);
+  if (context->paste) {
+    paste_close(context->paste);
   }
-  g_free(context->object_path);
   option_close(context->option); /* dispose here */
   config_close(context->config);
   keymap_close(context->keymap);
+  macro_close(context->macro);
   hook_close(context->hook);
+  triggers_close(context->triggers);
+  stats_close(context->stats);
   if (context->layout.uri_regex) {
     pcre2_code_free(context->layout.uri_regex);
   }
-  lua_close(context->lua);
+  if (context->lua) {
+    lua_close(context->lua);
+  }
+  /* the object path and the handler tags go away here at once */
+  arena_close(context->arena);
   g_free(context);
 }
 
 void context_add_handler_tag(Context* context, void* object, int handler_id)
 {
-  HandlerTag* tag = g_new0(HandlerTag, 1);
+  HandlerTag* tag = arena_alloc(context->arena, sizeof(HandlerTag));
   tag->handler_id = handler_id;
   tag->object = object;
-  context->handler_tags = g_list_append(context->handler_tags, tag);
+  tag->next = context->handler_tags;
+  context->handler_tags = tag;
 }
 
 void context_load_device(Context* context)
@@ -360,26 +565,19 @@ EXIT:
   dd("load theme end");
 }
 
-static bool context_perform_default(Context* context, unsigned key, GdkModifierType mod)
-{
-  unsigned i = 0;
-  while (DEFAULT_KEY_PAIRS[i].func) {
-    KeyPair* pair = &DEFAULT_KEY_PAIRS[i];
-    if ((key == pair->key) && !(~mod & pair->mod)) {
-      pair->func(context);
-      return true;
-    }
-    i++;
-  }
-  return false;
-}
-
-bool context_perform_keymap(Context* context, unsigned key, GdkModifierType mod)
+static bool context_perform_keymap_node(Context* context, KeymapNode* node)
 {
+  // the keymap func may unset keymaps and free the node
+  const KeyPair* pair = (const KeyPair*)node->default_data;
   if (context->lua) {
     bool result = false;
     char* error = NULL;
-    if (keymap_perform(context->keymap, context->lua, key, mod, &result, &error)) {
+    gint64 started_at = node->ref != LUA_NOREF ? stats_begin(context->stats) : 0;
+    char* name = started_at ? g_strdup(node->accelerator) : NULL;
+    bool performed = keymap_perform(node, context->lua, &result, &error);
+    stats_end(context->stats, "keymap", name, started_at);
+    g_free(name);
+    if (performed) {
       // if the keymap func is normally excuted,  default action will be canceled.
       // if `return true` in the keymap func, default action will be performed.
       if (!result) {
@@ -394,10 +592,75 @@ bool context_perform_keymap(Context* context, unsigned key, GdkModifierType mod)
       }
     }
   }
-  if (context_get_bool(context, "ignore_default_keymap")) {
+  if (!pair || context_get_bool(context, "ignore_default_keymap")) {
     return false;
   }
-  return context_perform_default(context, key, mod);
+  pair->func(context);
+  return true;
+}
+
+bool context_perform_keymap(Context* context, unsigned key, GdkModifierType mod)
+{
+  KeymapNode* node = NULL;
+  switch (keymap_feed(context->keymap, key, mod, &node)) {
+    case KEYMAP_STATUS_NONE:
+      return false;
+    case KEYMAP_STATUS_PENDING:
+      return true;
+    case KEYMAP_STATUS_MATCHED:
+      break;
+  }
+  return context_perform_keymap_node(context, node);
+}
+
+static void on_keymap_expired(KeymapNode* node, void* user_data)
+{
+  context_perform_keymap_node((Context*)user_data, node);
+}
+
+// Dispatches a press and a release of the key as if it were typed, so that
+// it goes through the keymaps and VTE.
+bool context_send_key(Context* context, unsigned key, GdkModifierType mod)
+{
+  if (context->device == NULL) {
+    g_warning("Could not get input device.");
+    return false;
+  }
+  GdkEvent* event = gdk_event_new(GDK_KEY_PRESS);
+  gdk_event_set_device(event, context->device);
+  event->key.window = g_object_ref(gtk_widget_get_window(GTK_WIDGET(context->layout.window)));
+  event->key.send_event = false;
+  event->key.time = GDK_CURRENT_TIME;
+  event->key.state = mod;
+  event->key.keyval = key;
+  gtk_main_do_event((GdkEvent*)event);
+  event->type = GDK_KEY_RELEASE;
+  gtk_main_do_event((GdkEvent*)event);
+  gdk_event_free((GdkEvent*)event);
+  return true;
+}
+
+static bool macro_is_bound(const MacroKey* key, void* user_data)
+{
+  Context* context = (Context*)user_data;
+  return keymap_may_handle(context->keymap, gdk_keyval_to_lower(key->keyval));
+}
+
+static void macro_feed(const char* text, size_t length, void* user_data)
+{
+  Context* context = (Context*)user_data;
+  vte_terminal_feed_child(context->layout.vte, text, length);
+}
+
+static void macro_send(const MacroKey* key, void* user_data)
+{
+  context_send_key((Context*)user_data, key->keyval, key->state);
+}
+
+bool context_play_macro(Context* context, unsigned count)
+{
+  const MacroSink sink = { macro_is_bound, macro_feed, macro_send };
+  return macro_play(context->macro, count, &sink, context);
 }
 
 void context_handle_signal(Context* context, const char* signal_name, GVariant* parameters)
@@ -409,6 +672,7 @@ void context_build_layout(Context* context)
 {
   GtkWindow* window = context->layout.window = GTK_WINDOW(gtk_application_window_new(GTK_APPLICATION(app->gapp)));
   VteTerminal* vte = context->layout.vte = VTE_TERMINAL(vte_terminal_new());
+  context->paste = paste_init(vte);
   GtkBox* hbox = context->layout.hbox = GTK_BOX(gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 0));
   GtkBox* vbox = context->layout.vbox = GTK_BOX(gtk_box_new(GTK_ORIENTATION_VERTICAL, 0));
   context->layout.uri_tag = -1;
@@ -502,6 +766,7 @@ bool context_get_bool(Context* context, const char* key)
 void context_set_str(Context* context, const char* key, const char* value)
 {
   MetaEntry* e = meta_get_entry(app->meta, key);
+  context->config_generation++;
   if (e->setter) {
     ((PropertyStrSetter)e->setter)(context, key, value);
     return;
@@ -516,6 +781,7 @@ void context_set_str(Context* context, const char* key, const char* value)
 void context_set_int(Context* context, const char* key, int value)
 {
   MetaEntry* e = meta_get_entry(app->meta, key);
+  context->config_generation++;
   if (e->setter) {
     ((PropertyIntSetter)e->setter)(context, key, value);
     return;
@@ -530,6 +796,7 @@ void context_set_int(Context* context, const char* key, int value)
 void context_set_bool(Context* context, const char* key, bool value)
 {
   MetaEntry* e = meta_get_entry(app->meta, key);
+  context->config_generation++;
   if (e->setter) {
     ((PropertyBoolSetter)e->setter)(context, key, value);
     return;
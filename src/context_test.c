@@ -0,0 +1,94 @@
+/**
+ * context_test.c
+ *
+ * Copyright (c) 2026 endaaman
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license. See the LICENSE file for details.
+ */
+
+#include <unistd.h>
+#include "tym_test.h"
+#include "context.h"
+
+static long get_rss_kb()
+{
+  char* content = NULL;
+  if (!g_file_get_contents("/proc/self/statm", &content, NULL, NULL)) {
+    return -1;
+  }
+  long pages = -1;
+  if (sscanf(content, "%*d %ld", &pages) != 1) {
+    pages = -1;
+  }
+  g_free(content);
+  return pages < 0 ? -1 : pages * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+static void open_and_close(Meta* meta, int count)
+{
+  char* argv[] = {
+    "tym",
+    "-u", "NONE",
+    "--title", "context test",
+    "--width", "100",
+    "--", "sh", "-c", "true",
+    NULL
+  };
+  int argc = sizeof(argv) / sizeof(char*) - 1;
+
+  for (int i = 0; i < count; i++) {
+    Option* option = option_init(meta_get_option_entries(meta));
+    g_assert(option_parse(option, argc, argv));
+    Context* context = context_init(i, option);
+    context_load_lua_context(context);
+    context_add_handler_tag(context, NULL, 0);
+    g_assert_cmpstr(context->object_path, !=, NULL);
+    context_close(context);
+  }
+}
+
+static void test_open_and_close()
+{
+  long before = get_rss_kb();
+  if (before < 0) {
+    g_test_skip("/proc/self/statm is not available");
+    return;
+  }
+  Meta* meta = meta_init();
+
+  // let the allocator settle before taking the baseline
+  open_and_close(meta, 100);
+  before = get_rss_kb();
+  open_and_close(meta, 1000);
+  long after = get_rss_kb();
+  dd("RSS: %ld kB -> %ld kB", before, after);
+
+  // a leak of 1 kB per context would show up as 1000 kB
+  g_assert_cmpint(after - before, <, 512);
+  meta_close(meta);
+}
+
+static void test_arena()
+{
+  Arena* arena = arena_init(64);
+  char* s = arena_strdup(arena, "tym");
+  g_assert_cmpstr(s, ==, "tym");
+  char* p = arena_strdup_printf(arena, "%s/%d", "path", 12);
+  g_assert_cmpstr(p, ==, "path/12");
+  // larger than a chunk
+  char* large = arena_alloc(arena, 1000);
+  for (int i = 0; i < 1000; i++) {
+    g_assert_cmpint(large[i], ==, 0);
+  }
+  // earlier blocks stay intact
+  g_assert_cmpstr(s, ==, "tym");
+  g_assert_cmpstr(arena_strdup(arena, "after"), ==, "after");
+  arena_close(arena);
+}
+
+void test_context()
+{
+  test_arena();
+  test_open_and_close();
+}
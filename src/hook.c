@@ -8,106 +8,86 @@
  */
 
 #include "hook.h"
-
-
-#define HOOK_KEY_TITLE "title"
-#define HOOK_KEY_BELL "bell"
-#define HOOK_KEY_CLICKED "clicked"
-#define HOOK_KEY_SCROLL "scroll"
-#define HOOK_KEY_DRAG "drag"
-#define HOOK_KEY_ACTIVATED "activated"
-#define HOOK_KEY_DEACTIVATED "deactivated"
-#define HOOK_KEY_SELECTED "selected"
-#define HOOK_KEY_UNSELECTED "unselected"
-#define HOOK_KEY_RESIZED "resized"
-#define HOOK_KEY_SIGNAL "signal"
-
-
-const char* HOOK_KEYS[] = {
-  HOOK_KEY_TITLE,
-  HOOK_KEY_BELL,
-  HOOK_KEY_CLICKED,
-  HOOK_KEY_SCROLL,
-  HOOK_KEY_DRAG,
-  HOOK_KEY_ACTIVATED,
-  HOOK_KEY_DEACTIVATED,
-  HOOK_KEY_SELECTED,
-  HOOK_KEY_UNSELECTED,
-  HOOK_KEY_RESIZED,
-  HOOK_KEY_SIGNAL,
-  NULL
+#include "context.h"
+#include "variant.h"
+
+
+const char* HOOK_KEYS[HOOK_COUNT] = {
+  [HOOK_TITLE]       = "title",
+  [HOOK_BELL]        = "bell",
+  [HOOK_CLICKED]     = "clicked",
+  [HOOK_SCROLL]      = "scroll",
+  [HOOK_DRAG]        = "drag",
+  [HOOK_ACTIVATED]   = "activated",
+  [HOOK_DEACTIVATED] = "deactivated",
+  [HOOK_SELECTED]    = "selected",
+  [HOOK_UNSELECTED]  = "unselected",
+  [HOOK_RESIZED]     = "resized",
+  [HOOK_SIGNAL]      = "signal",
+  [HOOK_OUTPUT]      = "output",
 };
 
-Hook* hook_init()
+Hook* hook_init(Stats* stats)
 {
   Hook* hook = g_new0(Hook, 1);
-  hook->refs = g_hash_table_new_full(
-    g_str_hash,
-    g_str_equal,
-    (GDestroyNotify)g_free,
-    (GDestroyNotify)g_free
-  );
-
-  int i = 0;
-  while (HOOK_KEYS[i]) {
-    int* p = g_new0(int, 1);
-    *p = -1;
-    g_hash_table_insert(hook->refs, g_strdup(HOOK_KEYS[i]), p);
-    i += 1;
+  hook->stats = stats;
+  for (int i = 0; i < HOOK_COUNT; i++) {
+    hook->refs[i] = LUA_NOREF;
   }
   return hook;
 }
 
 void hook_close(Hook* hook)
 {
-  g_hash_table_destroy(hook->refs);
   g_free(hook);
 }
 
-static int hook_get_ref(Hook* hook, const char* key)
+// Returns HOOK_COUNT for an invalid key.
+HookType hook_get_type(const char* key)
 {
-  int* ptr = g_hash_table_lookup(hook->refs, key);
-  if (!ptr) {
-    dd("invalid hook key: '%s'", key);
-    return -1;
+  for (int i = 0; i < HOOK_COUNT; i++) {
+    if (is_equal(HOOK_KEYS[i], key)) {
+      return i;
+    }
   }
-  return *ptr;
+  return HOOK_COUNT;
+}
+
+bool hook_is_set(Hook* hook, HookType type)
+{
+  return hook->refs[type] != LUA_NOREF;
 }
 
+// `ref` can be LUA_NOREF to unset the hook.
 bool hook_set_ref(Hook* hook, const char* key, int ref, int* old_ref)
 {
   assert(old_ref);
-  void* old_key = NULL;
-  void* old_value = NULL;
-  bool has_value = g_hash_table_lookup_extended(hook->refs, key, &old_key, &old_value);
-  if (old_value) {
-    *old_ref = *(int*)old_value;
-  }
-  if (!has_value) {
+  HookType type = hook_get_type(key);
+  if (type == HOOK_COUNT) {
+    dd("invalid hook key: '%s'", key);
     return false;
   }
-  g_hash_table_remove(hook->refs, old_key);
-  g_hash_table_insert(hook->refs, g_strdup(key), memdup(&ref, sizeof(int)));
+  *old_ref = hook->refs[type];
+  hook->refs[type] = ref;
   dd("hook '%s' is registered. ref: %d", key, ref);
   return true;
 }
 
-static bool hook_perform(Hook* hook, lua_State* L, const char* key, int narg, int nresult)
+// The callers check `hook_is_set()` before pushing the arguments.
+static bool hook_perform(Hook* hook, lua_State* L, HookType type, int narg, int nresult)
 {
-  int ref = hook_get_ref(hook, key);
-  if (ref < 0) {
-    lua_pop(L, narg);
-    return false;
-  }
-  lua_rawgeti(L, LUA_REGISTRYINDEX, ref);
+  lua_rawgeti(L, LUA_REGISTRYINDEX, hook->refs[type]);
   if (!lua_isfunction(L, -1)) {
-    lua_pop(L, 1); // pop none-function
+    lua_pop(L, narg + 1); // pop none-function and the arguments
     dd("tried to call hook which is not function.");
     return false;
   }
   lua_insert(L, - narg - 1);
-  dd("perform custom hook: %s", key);
-  if (lua_pcall(L, narg, nresult, 0) != LUA_OK) {
+  dd("perform custom hook: %s", HOOK_KEYS[type]);
+  gint64 started_at = stats_begin(hook->stats);
+  int status = context_pcall(context_from_lua(L), narg, nresult);
+  stats_end(hook->stats, "hook", HOOK_KEYS[type], started_at);
+  if (status != LUA_OK) {
     luaX_warn(L, "Error in hook function: '%s'", lua_tostring(L, -1));
     lua_pop(L, 1); // error
     return false;
@@ -117,11 +97,11 @@ static bool hook_perform(Hook* hook, lua_State* L, const char* key, int narg, in
 
 bool hook_perform_title(Hook* hook, lua_State* L, const char* title, bool* result)
 {
-  if (!L) {
+  if (!L || !hook_is_set(hook, HOOK_TITLE)) {
     return false;
   }
   lua_pushstring(L, title);
-  bool succeeded = hook_perform(hook, L, HOOK_KEY_TITLE, 1, 1);
+  bool succeeded = hook_perform(hook, L, HOOK_TITLE, 1, 1);
   if (!succeeded) {
     return false;
   }
@@ -133,10 +113,10 @@ bool hook_perform_title(Hook* hook, lua_State* L, const char* title, bool* resul
 bool hook_perform_bell(Hook* hook, lua_State* L, bool* result)
 {
   assert(result);
-  if (!L) {
+  if (!L || !hook_is_set(hook, HOOK_BELL)) {
     return false;
   }
-  bool succeeded = hook_perform(hook, L, HOOK_KEY_BELL, 0, 1);
+  bool succeeded = hook_perform(hook, L, HOOK_BELL, 0, 1);
   if (!succeeded) {
     return false;
   }
@@ -148,12 +128,12 @@ bool hook_perform_bell(Hook* hook, lua_State* L, bool* result)
 bool hook_perform_clicked(Hook* hook, lua_State* L, int button, const char* uri, bool* result)
 {
   assert(result);
-  if (!L) {
+  if (!L || !hook_is_set(hook, HOOK_CLICKED)) {
     return false;
   }
   lua_pushinteger(L, button);
   lua_pushstring(L, uri);
-  bool succeeded = hook_perform(hook, L, HOOK_KEY_CLICKED, 2, 1);
+  bool succeeded = hook_perform(hook, L, HOOK_CLICKED, 2, 1);
   if (!succeeded) {
     return false;
   }
@@ -165,14 +145,14 @@ bool hook_perform_clicked(Hook* hook, lua_State* L, int button, const char* uri,
 bool hook_perform_scroll(Hook* hook, lua_State* L, double delta_x, double delta_y, double x, double y, bool* result)
 {
   assert(result);
-  if (!L) {
+  if (!L || !hook_is_set(hook, HOOK_SCROLL)) {
     return false;
   }
   lua_pushnumber(L, delta_x);
   lua_pushnumber(L, delta_y);
   lua_pushnumber(L, x);
-  lua_pushnumber(L, x);
-  bool succeeded = hook_perform(hook, L, HOOK_KEY_SCROLL, 4, 1);
+  lua_pushnumber(L, y);
+  bool succeeded = hook_perform(hook, L, HOOK_SCROLL, 4, 1);
   if (!succeeded) {
     return false;
   }
@@ -184,8 +164,11 @@ bool hook_perform_scroll(Hook* hook, lua_State* L, double delta_x, double delta_
 bool hook_perform_drag(Hook* hook, lua_State* L, char* path, bool* result)
 {
   assert(result);
+  if (!L || !hook_is_set(hook, HOOK_DRAG)) {
+    return false;
+  }
   lua_pushstring(L, path);
-  bool succeeded = hook_perform(hook, L, HOOK_KEY_DRAG, 1, 1);
+  bool succeeded = hook_perform(hook, L, HOOK_DRAG, 1, 1);
   if (!succeeded) {
     return false;
   }
@@ -196,50 +179,64 @@ bool hook_perform_drag(Hook* hook, lua_State* L, char* path, bool* result)
 
 bool hook_perform_activated(Hook* hook, lua_State* L)
 {
-  if (!L) {
+  if (!L || !hook_is_set(hook, HOOK_ACTIVATED)) {
     return false;
   }
-  return hook_perform(hook, L, HOOK_KEY_ACTIVATED, 0, 0);
+  return hook_perform(hook, L, HOOK_ACTIVATED, 0, 0);
 }
 
 bool hook_perform_deactivated(Hook* hook, lua_State* L)
 {
-  if (!L) {
+  if (!L || !hook_is_set(hook, HOOK_DEACTIVATED)) {
     return false;
   }
-  return hook_perform(hook, L, HOOK_KEY_DEACTIVATED, 0, 0);
+  return hook_perform(hook, L, HOOK_DEACTIVATED, 0, 0);
 }
 
 bool hook_perform_selected(Hook* hook, lua_State* L, const char* text)
 {
-  if (!L) {
+  if (!L || !hook_is_set(hook, HOOK_SELECTED)) {
     return false;
   }
   lua_pushstring(L, text);
-  return hook_perform(hook, L, HOOK_KEY_SELECTED, 1, 0);
+  return hook_perform(hook, L, HOOK_SELECTED, 1, 0);
 }
 
 bool hook_perform_unselected(Hook* hook, lua_State* L)
 {
-  if (!L) {
+  if (!L || !hook_is_set(hook, HOOK_UNSELECTED)) {
     return false;
   }
-  return hook_perform(hook, L, HOOK_KEY_UNSELECTED, 0, 0);
+  return hook_perform(hook, L, HOOK_UNSELECTED, 0, 0);
 }
 
-bool hook_perform_resized(Hook* hook, lua_State* L)
+bool hook_perform_resized(Hook* hook, lua_State* L, long columns, long rows, int width, int height)
 {
-  if (!L) {
+  if (!L || !hook_is_set(hook, HOOK_RESIZED)) {
     return false;
   }
-  return hook_perform(hook, L, HOOK_KEY_RESIZED, 0, 0);
+  lua_pushinteger(L, columns);
+  lua_pushinteger(L, rows);
+  lua_pushinteger(L, width);
+  lua_pushinteger(L, height);
+  return hook_perform(hook, L, HOOK_RESIZED, 4, 0);
 }
 
-bool hook_perform_signal(Hook* hook, lua_State* L, const char* param)
+// Every parameter of the signal is passed, with its type kept.
+bool hook_perform_signal(Hook* hook, lua_State* L, GVariant* params)
 {
-  if (!L) {
+  if (!L || !hook_is_set(hook, HOOK_SIGNAL)) {
     return false;
   }
-  lua_pushstring(L, param);
-  return hook_perform(hook, L, HOOK_KEY_SIGNAL, 1, 0);
+  int narg = variant_push_children(L, params);
+  return hook_perform(hook, L, HOOK_SIGNAL, narg, 0);
+}
+
+bool hook_perform_output(Hook* hook, lua_State* L, const char* text)
+{
+  if (!L || !hook_is_set(hook, HOOK_OUTPUT)) {
+    return false;
+  }
+  lua_pushstring(L, text);
+  return hook_perform(hook, L, HOOK_OUTPUT, 1, 0);
 }
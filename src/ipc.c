@@ -29,12 +29,7 @@ typedef struct {
 void ipc_signal_hook(Context* context, GVariant* params)
 {
   df();
-  const char* param = NULL;
-  size_t size = g_variant_n_children(params);
-  if (size > 0) {
-    g_variant_get_child(params, 0, "s", &param);
-  }
-  hook_perform_signal(context->hook, context->lua, param);
+  hook_perform_signal(context->hook, context->lua, params);
 }
 
 SignalDef signals[] = {
@@ -45,15 +40,32 @@ SignalDef signals[] = {
 void ipc_method_get_ids(Context* context, GVariant* params, GDBusMethodInvocation* invocation)
 {
   GVariantBuilder *builder = g_variant_builder_new(G_VARIANT_TYPE_ARRAY);
-  for (GList* li = app->contexts; li != NULL; li = li->next) {
-    Context* c = (Context*)li->data;
-    g_variant_builder_add(builder, "i", c->id);
+  GArray* ids = registry_get_ids(app->contexts);
+  for (unsigned i = 0; i < ids->len; i++) {
+    g_variant_builder_add(builder, "i", g_array_index(ids, int, i));
   }
+  g_array_unref(ids);
   GVariant* v = g_variant_builder_end(builder);
   v = g_variant_new_tuple(&v, 1);
   g_dbus_method_invocation_return_value(invocation, v);
 }
 
+void ipc_method_get_stats(Context* context, GVariant* params, GDBusMethodInvocation* invocation)
+{
+  GVariantBuilder* builder = g_variant_builder_new(G_VARIANT_TYPE("a{s(uxx)}"));
+  GHashTableIter iter;
+  const char* name = NULL;
+  StatsEntry* e = NULL;
+  g_hash_table_iter_init(&iter, context->stats->entries);
+  while (g_hash_table_iter_next(&iter, (void**)&name, (void**)&e)) {
+    g_variant_builder_add(builder, "{s(uxx)}", name, e->count, e->total, e->max);
+  }
+  GVariant* v = g_variant_builder_end(builder);
+  g_variant_builder_unref(builder);
+  v = g_variant_new_tuple(&v, 1);
+  g_dbus_method_invocation_return_value(invocation, v);
+}
+
 void ipc_method_echo(Context* context, GVariant* params, GDBusMethodInvocation* invocation)
 {
   g_dbus_method_invocation_return_value(invocation, params);
@@ -67,7 +79,12 @@ static void ipc_do_lua(Context* context, GVariant* params, GDBusMethodInvocation
 
   char* result = NULL;
 
-  int suc = is_file ? luaL_dofile(L, param) : luaL_dostring(L, param);
+  gint64 started_at = stats_begin(context->stats);
+  int suc = is_file ? luaL_loadfile(L, param) : luaL_loadstring(L, param);
+  if (suc == LUA_OK) {
+    suc = context_pcall(context, 0, LUA_MULTRET);
+  }
+  stats_end(context->stats, "ipc", g_dbus_method_invocation_get_method_name(invocation), started_at);
 
   if (suc != 0) {
     result = g_strdup(lua_tostring(L, -1));
@@ -114,6 +131,7 @@ void ipc_method_exec_file(Context* context, GVariant* params, GDBusMethodInvocat
 MethodDef methods[] = {
   { "echo",      ipc_method_echo, },
   { "get_ids",   ipc_method_get_ids, },
+  { "get_stats", ipc_method_get_stats, },
   { "eval",      ipc_method_eval, },
   { "eval_file", ipc_method_eval_file, },
   { "exec",      ipc_method_exec, },
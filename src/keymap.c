@@ -8,103 +8,339 @@
  */
 
 #include "keymap.h"
+#include "context.h"
 
 
-typedef struct {
-  unsigned key;
-  GdkModifierType mod;
-  char* accelerator;
-  int ref;
-} KeymapEntry;
+// How long a sequence like `<Ctrl>a c` waits for its next key
+#define TYM_KEYMAP_SEQUENCE_TIMEOUT 1000
 
+// Bindings are kept in a trie keyed by (modifiers, keyval) so that a key press
+// is a single hash lookup however many keymaps there are. A node with children
+// is the prefix of a sequence, and a node can hold both a Lua function (`ref`)
+// and a default action (`default_data`) bound to the same key.
+//
+// `filter` has a bit set for the keyvals (in both cases, hashed into its size)
+// which start any binding, so that plain typing is passed to VTE before even
+// the modifiers are looked at.
 
-static void free_keymap_entry(KeymapEntry* e, void* user_data)
+
+static guint64 keymap_chord(unsigned key, GdkModifierType mod)
+{
+  return ((guint64)mod << 32) | key;
+}
+
+static KeymapNode* keymap_node_new(guint64 chord)
+{
+  KeymapNode* node = g_new0(KeymapNode, 1);
+  node->chord = chord;
+  node->ref = LUA_NOREF;
+  return node;
+}
+
+static void keymap_node_free(KeymapNode* node)
+{
+  if (node->children) {
+    g_hash_table_destroy(node->children);
+  }
+  g_free(node->accelerator);
+  g_free(node);
+}
+
+static KeymapNode* keymap_node_get_child(KeymapNode* node, guint64 chord, bool create)
+{
+  KeymapNode* child = node->children ? g_hash_table_lookup(node->children, &chord) : NULL;
+  if (child || !create) {
+    return child;
+  }
+  if (!node->children) {
+    node->children = g_hash_table_new_full(g_int64_hash, g_int64_equal, NULL, (GDestroyNotify)keymap_node_free);
+  }
+  child = keymap_node_new(chord);
+  g_hash_table_insert(node->children, &child->chord, child);
+  return child;
+}
+
+static bool keymap_node_is_empty(KeymapNode* node)
+{
+  return node->ref == LUA_NOREF && !node->default_data
+    && (!node->children || g_hash_table_size(node->children) == 0);
+}
+
+static bool keymap_is_modifier_key(unsigned key)
+{
+  return (GDK_KEY_Shift_L <= key && key <= GDK_KEY_Hyper_R)
+    || (GDK_KEY_ISO_Lock <= key && key <= GDK_KEY_ISO_Level5_Lock);
+}
+
+static void keymap_filter_add(Keymap* keymap, unsigned key)
+{
+  unsigned keys[] = { gdk_keyval_to_lower(key), gdk_keyval_to_upper(key) };
+  for (unsigned i = 0; i < G_N_ELEMENTS(keys); i++) {
+    unsigned bit = keys[i] % TYM_KEYMAP_FILTER_BITS;
+    keymap->filter[bit / 64] |= (guint64)1 << (bit % 64);
+  }
+}
+
+static void keymap_filter_rebuild(Keymap* keymap)
+{
+  memset(keymap->filter, 0, sizeof(keymap->filter));
+  if (!keymap->root->children) {
+    return;
+  }
+  GHashTableIter iter;
+  KeymapNode* node = NULL;
+  g_hash_table_iter_init(&iter, keymap->root->children);
+  while (g_hash_table_iter_next(&iter, NULL, (void**)&node)) {
+    keymap_filter_add(keymap, (unsigned)(node->chord & 0xffffffff));
+  }
+}
+
+// Parses `<Ctrl>a c` into chords. Returns NULL if any of the keys is invalid.
+static GArray* keymap_parse_sequence(const char* accelerator)
 {
-  // TODO: luaL_unref the ref
-  g_free(e->accelerator);
-  g_free(e);
+  GArray* chords = g_array_new(false, false, sizeof(guint64));
+  char** tokens = g_strsplit_set(accelerator, " \t", -1);
+  for (char** t = tokens; *t; t++) {
+    if (!**t) {
+      continue;
+    }
+    unsigned key;
+    GdkModifierType mod;
+    gtk_accelerator_parse(*t, &key, &mod);
+    if (0 == key && 0 == mod) {
+      g_array_free(chords, true);
+      chords = NULL;
+      break;
+    }
+    guint64 chord = keymap_chord(key, mod);
+    g_array_append_val(chords, chord);
+  }
+  g_strfreev(tokens);
+  if (chords && chords->len == 0) {
+    g_array_free(chords, true);
+    return NULL;
+  }
+  return chords;
 }
 
 Keymap* keymap_init()
 {
   Keymap* keymap = g_new0(Keymap, 1);
-  keymap->entries = NULL;
-
+  keymap->root = keymap_node_new(0);
   return keymap;
 }
 
-void keymap_reset(Keymap* keymap)
+static void keymap_clear_pending(Keymap* keymap)
 {
-  g_list_foreach(keymap->entries, (GFunc)free_keymap_entry, NULL);
-  g_list_free(keymap->entries);
-  keymap->entries = NULL;
+  keymap->pending = NULL;
+  if (keymap->pending_tag) {
+    g_source_remove(keymap->pending_tag);
+    keymap->pending_tag = 0;
+  }
+}
+
+static int keymap_pending_timeout(void* user_data)
+{
+  Keymap* keymap = (Keymap*)user_data;
+  dd("keymap sequence timed out");
+  keymap->pending_tag = 0;
+  KeymapNode* node = NULL;
+  if (keymap_expire(keymap, &node) && keymap->expire_func) {
+    keymap->expire_func(node, keymap->expire_data);
+  }
+  return G_SOURCE_REMOVE;
+}
+
+// Unrefs the Lua functions under `node` and drops the nodes left empty.
+static bool keymap_node_reset(KeymapNode* node, lua_State* L)
+{
+  if (node->children) {
+    GHashTableIter iter;
+    KeymapNode* child = NULL;
+    g_hash_table_iter_init(&iter, node->children);
+    while (g_hash_table_iter_next(&iter, NULL, (void**)&child)) {
+      if (keymap_node_reset(child, L)) {
+        g_hash_table_iter_remove(&iter);
+      }
+    }
+  }
+  if (node->ref != LUA_NOREF) {
+    luaL_unref(L, LUA_REGISTRYINDEX, node->ref);
+    node->ref = LUA_NOREF;
+  }
+  return keymap_node_is_empty(node);
+}
+
+// Default actions are kept.
+void keymap_reset(Keymap* keymap, lua_State* L)
+{
+  keymap_clear_pending(keymap);
+  keymap_node_reset(keymap->root, L);
+  keymap_filter_rebuild(keymap);
+}
+
+void keymap_set_expire_func(Keymap* keymap, KeymapExpireFunc func, void* user_data)
+{
+  keymap->expire_func = func;
+  keymap->expire_data = user_data;
 }
 
 void keymap_close(Keymap* keymap)
 {
-  keymap_reset(keymap);
+  keymap_clear_pending(keymap);
+  keymap_node_free(keymap->root);
   g_free(keymap);
 }
 
-bool keymap_add_entry(Keymap* keymap, const char* accelerator, int ref)
+bool keymap_set_default(Keymap* keymap, unsigned key, GdkModifierType mod, const void* data)
 {
-  unsigned key;
-  GdkModifierType mod;
-  gtk_accelerator_parse(accelerator, &key, &mod);
-  if (0 == key && 0 == mod) {
+  KeymapNode* node = keymap_node_get_child(keymap->root, keymap_chord(key, mod), true);
+  node->default_data = data;
+  keymap_filter_add(keymap, key);
+  return true;
+}
+
+bool keymap_add_entry(Keymap* keymap, lua_State* L, const char* accelerator, int ref)
+{
+  GArray* chords = keymap_parse_sequence(accelerator);
+  if (!chords) {
     return false;
   }
-  bool removed = keymap_remove_entry(keymap, accelerator);
-  KeymapEntry* e = g_new(KeymapEntry, 1);
-  e->key = key;
-  e->mod = mod;
-  e->accelerator = g_strdup(accelerator);
-  e->ref = ref;
-  keymap->entries = g_list_append(keymap->entries, e);
-  if (removed) {
-    dd("keymap (%s mod: %x, key: %x) has been overwritten", accelerator, mod, key);
+  keymap_clear_pending(keymap);
+  keymap_filter_add(keymap, (unsigned)(g_array_index(chords, guint64, 0) & 0xffffffff));
+  KeymapNode* node = keymap->root;
+  for (unsigned i = 0; i < chords->len; i++) {
+    node = keymap_node_get_child(node, g_array_index(chords, guint64, i), true);
+  }
+  g_array_free(chords, true);
+
+  bool overwritten = node->ref != LUA_NOREF;
+  if (overwritten) {
+    luaL_unref(L, LUA_REGISTRYINDEX, node->ref);
+  }
+  node->ref = ref;
+  g_free(node->accelerator);
+  node->accelerator = g_strdup(accelerator);
+  if (overwritten) {
+    dd("keymap (%s) has been overwritten", accelerator);
   } else {
-    dd("keymap (%s mod: %x, key: %x) has been newly assined", accelerator, mod, key);
+    dd("keymap (%s) has been newly assined", accelerator);
+  }
+  if (node->children) {
+    dd("keymap (%s) starts sequences too, so it is called when they time out", accelerator);
   }
   return true;
 }
 
-bool keymap_remove_entry(Keymap* keymap, const char* accelerator)
+static bool keymap_node_remove(KeymapNode* node, lua_State* L, GArray* chords, unsigned depth, bool* removed)
 {
-  for (GList* li = keymap->entries; li != NULL; li = li->next) {
-    KeymapEntry* e = (KeymapEntry*)li->data;
-    if (is_equal(e->accelerator, accelerator)) {
-      keymap->entries = g_list_remove(keymap->entries, e);
-      g_free(e);
-      return true;
+  if (depth == chords->len) {
+    if (node->ref != LUA_NOREF) {
+      luaL_unref(L, LUA_REGISTRYINDEX, node->ref);
+      node->ref = LUA_NOREF;
+      *removed = true;
     }
+    return keymap_node_is_empty(node);
+  }
+  guint64 chord = g_array_index(chords, guint64, depth);
+  KeymapNode* child = keymap_node_get_child(node, chord, false);
+  if (child && keymap_node_remove(child, L, chords, depth + 1, removed)) {
+    g_hash_table_remove(node->children, &chord);
+  }
+  return keymap_node_is_empty(node);
+}
+
+bool keymap_remove_entry(Keymap* keymap, lua_State* L, const char* accelerator)
+{
+  GArray* chords = keymap_parse_sequence(accelerator);
+  if (!chords) {
+    return false;
+  }
+  keymap_clear_pending(keymap);
+  bool removed = false;
+  keymap_node_remove(keymap->root, L, chords, 0, &removed);
+  g_array_free(chords, true);
+  keymap_filter_rebuild(keymap);
+  return removed;
+}
+
+// False when `key` surely has nothing to do with any binding. `key` can be in
+// either case and have the modifiers not masked yet.
+bool keymap_may_handle(Keymap* keymap, unsigned key)
+{
+  if (keymap->pending) {
+    return true;
   }
-  return false;
+  unsigned bit = key % TYM_KEYMAP_FILTER_BITS;
+  return keymap->filter[bit / 64] & ((guint64)1 << (bit % 64));
 }
 
-bool keymap_perform(Keymap* keymap, lua_State* L, unsigned key, GdkModifierType mod, bool* result, char** error)
+// Advances the sequence by a key press. When a sequence is pending and the key
+// does not continue it, the sequence is dropped and the key is looked up again
+// from the top.
+KeymapStatus keymap_feed(Keymap* keymap, unsigned key, GdkModifierType mod, KeymapNode** matched)
+{
+  KeymapNode* parent = keymap->pending ? keymap->pending : keymap->root;
+  if (keymap->pending && keymap_is_modifier_key(key)) {
+    // wait for the next key while modifiers of it are being pressed
+    return KEYMAP_STATUS_PENDING;
+  }
+  KeymapNode* node = keymap_node_get_child(parent, keymap_chord(key, mod), false);
+  if (!node && keymap->pending) {
+    dd("keymap sequence was not continued by (mod: %x, key: %x)", mod, key);
+    // the prefix ends here as if it timed out, then the key starts over
+    KeymapNode* expired = NULL;
+    if (keymap_expire(keymap, &expired) && keymap->expire_func) {
+      keymap->expire_func(expired, keymap->expire_data);
+    }
+    return keymap_feed(keymap, key, mod, matched);
+  }
+  keymap_clear_pending(keymap);
+  if (!node) {
+    return KEYMAP_STATUS_NONE;
+  }
+  if (node->children && g_hash_table_size(node->children) > 0) {
+    keymap->pending = node;
+    keymap->pending_tag = g_timeout_add(TYM_KEYMAP_SEQUENCE_TIMEOUT, keymap_pending_timeout, keymap);
+    return KEYMAP_STATUS_PENDING;
+  }
+  *matched = node;
+  return KEYMAP_STATUS_MATCHED;
+}
+
+// Drops the pending sequence. True when the key which started it is bound on
+// its own, and that is set to `matched`.
+bool keymap_expire(Keymap* keymap, KeymapNode** matched)
+{
+  KeymapNode* node = keymap->pending;
+  keymap_clear_pending(keymap);
+  if (!node || (node->ref == LUA_NOREF && !node->default_data)) {
+    return false;
+  }
+  *matched = node;
+  return true;
+}
+
+bool keymap_perform(KeymapNode* node, lua_State* L, bool* result, char** error)
 {
   assert(result);
   assert(error);
-  for (GList* li = keymap->entries; li != NULL; li = li->next) {
-    KeymapEntry* e = (KeymapEntry*)li->data;
-    if (key == e->key && mod == e->mod) {
-      dd("performing keymap: %s (mod: %x, key: %x)", e->accelerator, mod, key);
-      lua_rawgeti(L, LUA_REGISTRYINDEX, e->ref);
-      if (!lua_isfunction(L, -1)) {
-        lua_pop(L, 1); // pop none-function
-        dd("tried to call keymap [%s] which is not function.", e->accelerator);
-        return false;
-      }
-      if (lua_pcall(L, 0, 1, 0) != LUA_OK) {
-        *error = g_strdup(lua_tostring(L, -1));
-        lua_pop(L, 1); // error
-        return false;
-      }
-      *result = lua_toboolean(L, -1);
-      lua_pop(L, 1);
-      return true;
-    }
+  if (node->ref == LUA_NOREF) {
+    return false;
   }
-  return false;
+  dd("performing keymap: %s", node->accelerator);
+  lua_rawgeti(L, LUA_REGISTRYINDEX, node->ref);
+  if (!lua_isfunction(L, -1)) {
+    lua_pop(L, 1); // pop none-function
+    dd("tried to call keymap [%s] which is not function.", node->accelerator);
+    return false;
+  }
+  if (context_pcall(context_from_lua(L), 0, 1) != LUA_OK) {
+    *error = g_strdup(lua_tostring(L, -1));
+    lua_pop(L, 1); // error
+    return false;
+  }
+  *result = lua_toboolean(L, -1);
+  lua_pop(L, 1);
+  return true;
 }
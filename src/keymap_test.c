@@ -0,0 +1,161 @@
+/**
+ * keymap_test.c
+ *
+ * Copyright (c) 2026 endaaman
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license. See the LICENSE file for details.
+ */
+
+#include "tym_test.h"
+#include "keymap.h"
+
+static int ref_function(lua_State* L)
+{
+  lua_pushcfunction(L, luaopen_base);
+  return luaL_ref(L, LUA_REGISTRYINDEX);
+}
+
+static void test_single()
+{
+  lua_State* L = luaL_newstate();
+  Keymap* keymap = keymap_init();
+  static const int data = 0;
+  KeymapNode* node = NULL;
+
+  g_assert(keymap_set_default(keymap, GDK_KEY_c, GDK_CONTROL_MASK | GDK_SHIFT_MASK, &data));
+  g_assert(keymap_add_entry(keymap, L, "<Ctrl>o", ref_function(L)));
+  g_assert_false(keymap_add_entry(keymap, L, "<Ctrl>", LUA_NOREF));
+
+  g_assert(keymap_may_handle(keymap, GDK_KEY_o));
+  g_assert(keymap_may_handle(keymap, GDK_KEY_C));
+  g_assert_false(keymap_may_handle(keymap, GDK_KEY_p));
+  g_assert_cmpint(keymap_feed(keymap, GDK_KEY_o, GDK_CONTROL_MASK, &node), ==, KEYMAP_STATUS_MATCHED);
+  g_assert(is_equal(node->accelerator, "<Ctrl>o"));
+  g_assert_cmpint(keymap_feed(keymap, GDK_KEY_o, 0, &node), ==, KEYMAP_STATUS_NONE);
+  g_assert_cmpint(keymap_feed(keymap, GDK_KEY_c, GDK_CONTROL_MASK | GDK_SHIFT_MASK, &node), ==, KEYMAP_STATUS_MATCHED);
+  g_assert(node->default_data == &data);
+  g_assert_cmpint(node->ref, ==, LUA_NOREF);
+
+  // the default action is kept
+  keymap_reset(keymap, L);
+  g_assert_false(keymap_may_handle(keymap, GDK_KEY_o));
+  g_assert_cmpint(keymap_feed(keymap, GDK_KEY_o, GDK_CONTROL_MASK, &node), ==, KEYMAP_STATUS_NONE);
+  g_assert_cmpint(keymap_feed(keymap, GDK_KEY_c, GDK_CONTROL_MASK | GDK_SHIFT_MASK, &node), ==, KEYMAP_STATUS_MATCHED);
+
+  keymap_close(keymap);
+  lua_close(L);
+}
+
+static void test_sequence()
+{
+  lua_State* L = luaL_newstate();
+  Keymap* keymap = keymap_init();
+  KeymapNode* node = NULL;
+
+  g_assert(keymap_add_entry(keymap, L, "<Ctrl>a c", ref_function(L)));
+  g_assert(keymap_add_entry(keymap, L, "<Ctrl>a <Shift>d", ref_function(L)));
+  g_assert(keymap_add_entry(keymap, L, "x", ref_function(L)));
+
+  g_assert_cmpint(keymap_feed(keymap, GDK_KEY_a, GDK_CONTROL_MASK, &node), ==, KEYMAP_STATUS_PENDING);
+  g_assert_cmpint(keymap_feed(keymap, GDK_KEY_c, 0, &node), ==, KEYMAP_STATUS_MATCHED);
+  g_assert(is_equal(node->accelerator, "<Ctrl>a c"));
+
+  // modifiers pressed for the next key do not break the sequence
+  g_assert_cmpint(keymap_feed(keymap, GDK_KEY_a, GDK_CONTROL_MASK, &node), ==, KEYMAP_STATUS_PENDING);
+  g_assert(keymap_may_handle(keymap, GDK_KEY_Shift_L));
+  g_assert_cmpint(keymap_feed(keymap, GDK_KEY_Shift_L, 0, &node), ==, KEYMAP_STATUS_PENDING);
+  g_assert_cmpint(keymap_feed(keymap, GDK_KEY_d, GDK_SHIFT_MASK, &node), ==, KEYMAP_STATUS_MATCHED);
+  g_assert(is_equal(node->accelerator, "<Ctrl>a <Shift>d"));
+
+  // a key which does not continue the sequence is looked up from the top
+  g_assert_cmpint(keymap_feed(keymap, GDK_KEY_a, GDK_CONTROL_MASK, &node), ==, KEYMAP_STATUS_PENDING);
+  g_assert_cmpint(keymap_feed(keymap, GDK_KEY_x, 0, &node), ==, KEYMAP_STATUS_MATCHED);
+  g_assert(is_equal(node->accelerator, "x"));
+  g_assert_cmpint(keymap_feed(keymap, GDK_KEY_c, 0, &node), ==, KEYMAP_STATUS_NONE);
+
+  // removing the last sequence under a prefix removes the prefix too
+  g_assert(keymap_remove_entry(keymap, L, "<Ctrl>a c"));
+  g_assert_false(keymap_remove_entry(keymap, L, "<Ctrl>a c"));
+  g_assert_cmpint(keymap_feed(keymap, GDK_KEY_a, GDK_CONTROL_MASK, &node), ==, KEYMAP_STATUS_PENDING);
+  g_assert_cmpint(keymap_feed(keymap, GDK_KEY_c, 0, &node), ==, KEYMAP_STATUS_NONE);
+  g_assert(keymap_remove_entry(keymap, L, "<Ctrl>a <Shift>d"));
+  g_assert_cmpint(keymap_feed(keymap, GDK_KEY_a, GDK_CONTROL_MASK, &node), ==, KEYMAP_STATUS_NONE);
+
+  keymap_close(keymap);
+  lua_close(L);
+}
+
+static void test_expire()
+{
+  lua_State* L = luaL_newstate();
+  Keymap* keymap = keymap_init();
+  KeymapNode* node = NULL;
+
+  g_assert(keymap_add_entry(keymap, L, "<Ctrl>a c", ref_function(L)));
+  g_assert_false(keymap_expire(keymap, &node));
+
+  // an unbound prefix leaves nothing to perform
+  g_assert_cmpint(keymap_feed(keymap, GDK_KEY_a, GDK_CONTROL_MASK, &node), ==, KEYMAP_STATUS_PENDING);
+  g_assert_false(keymap_expire(keymap, &node));
+  g_assert_null(keymap->pending);
+
+  // a key bound on its own as well is performed once the sequence expires
+  g_assert(keymap_add_entry(keymap, L, "<Ctrl>a", ref_function(L)));
+  g_assert_cmpint(keymap_feed(keymap, GDK_KEY_a, GDK_CONTROL_MASK, &node), ==, KEYMAP_STATUS_PENDING);
+  g_assert(keymap_expire(keymap, &node));
+  g_assert(is_equal(node->accelerator, "<Ctrl>a"));
+  g_assert_null(keymap->pending);
+  g_assert_cmpuint(keymap->pending_tag, ==, 0);
+  g_assert_cmpint(keymap_feed(keymap, GDK_KEY_c, 0, &node), ==, KEYMAP_STATUS_NONE);
+
+  keymap_close(keymap);
+  lua_close(L);
+}
+
+static void count_expired(KeymapNode* node, void* user_data)
+{
+  g_assert(is_equal(node->accelerator, "<Ctrl>a"));
+  (*(int*)user_data)++;
+}
+
+static void test_interrupt()
+{
+  lua_State* L = luaL_newstate();
+  Keymap* keymap = keymap_init();
+  KeymapNode* node = NULL;
+  int expired = 0;
+  keymap_set_expire_func(keymap, count_expired, &expired);
+
+  g_assert(keymap_add_entry(keymap, L, "<Ctrl>a c", ref_function(L)));
+  g_assert(keymap_add_entry(keymap, L, "<Ctrl>a", ref_function(L)));
+  g_assert(keymap_add_entry(keymap, L, "d", ref_function(L)));
+
+  // a key not continuing the sequence performs the prefix, then itself
+  g_assert_cmpint(keymap_feed(keymap, GDK_KEY_a, GDK_CONTROL_MASK, &node), ==, KEYMAP_STATUS_PENDING);
+  g_assert_cmpint(keymap_feed(keymap, GDK_KEY_d, 0, &node), ==, KEYMAP_STATUS_MATCHED);
+  g_assert(is_equal(node->accelerator, "d"));
+  g_assert_cmpint(expired, ==, 1);
+  g_assert_null(keymap->pending);
+
+  // an unbound key after the prefix is passed through
+  g_assert_cmpint(keymap_feed(keymap, GDK_KEY_a, GDK_CONTROL_MASK, &node), ==, KEYMAP_STATUS_PENDING);
+  g_assert_cmpint(keymap_feed(keymap, GDK_KEY_x, 0, &node), ==, KEYMAP_STATUS_NONE);
+  g_assert_cmpint(expired, ==, 2);
+
+  // completing the sequence does not perform the prefix
+  g_assert_cmpint(keymap_feed(keymap, GDK_KEY_a, GDK_CONTROL_MASK, &node), ==, KEYMAP_STATUS_PENDING);
+  g_assert_cmpint(keymap_feed(keymap, GDK_KEY_c, 0, &node), ==, KEYMAP_STATUS_MATCHED);
+  g_assert_cmpint(expired, ==, 2);
+
+  keymap_close(keymap);
+  lua_close(L);
+}
+
+void test_keymap()
+{
+  test_single();
+  test_sequence();
+  test_expire();
+  test_interrupt();
+}
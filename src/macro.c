@@ -0,0 +1,130 @@
+/**
+ * macro.c
+ *
+ * Copyright (c) 2026 endaaman
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license. See the LICENSE file for details.
+ */
+
+#include "macro.h"
+
+
+// A macro is kept as the keyval and the modifiers of each press. When it is
+// played, runs of keys which only type a character are joined and written to
+// the PTY at once, and only the rest are sent as key events, as they may be
+// bound or be translated by VTE according to the terminal modes. Sending an
+// event can run Lua, so recording and playing again are refused while playing,
+// and closing then is deferred until the playback unwinds.
+
+Macro* macro_init()
+{
+  Macro* macro = g_new0(Macro, 1);
+  macro->keys = g_array_new(false, false, sizeof(MacroKey));
+  macro->text = g_string_new(NULL);
+  return macro;
+}
+
+static void macro_free(Macro* macro)
+{
+  g_array_unref(macro->keys);
+  g_string_free(macro->text, true);
+  g_free(macro);
+}
+
+void macro_close(Macro* macro)
+{
+  if (macro->playing) {
+    macro->closed = true;
+    return;
+  }
+  macro_free(macro);
+}
+
+bool macro_start(Macro* macro)
+{
+  if (macro->playing) {
+    return false;
+  }
+  g_array_set_size(macro->keys, 0);
+  macro->recording = true;
+  return true;
+}
+
+unsigned macro_stop(Macro* macro)
+{
+  macro->recording = false;
+  return macro->keys->len;
+}
+
+bool macro_is_recording(Macro* macro)
+{
+  return macro->recording;
+}
+
+void macro_record(Macro* macro, unsigned keyval, unsigned state)
+{
+  if (!macro->recording || macro->playing) {
+    return;
+  }
+  MacroKey key = { .keyval = keyval, .state = state };
+  g_array_append_val(macro->keys, key);
+}
+
+unsigned macro_get_length(Macro* macro)
+{
+  return macro->keys->len;
+}
+
+// The printable character typed by `key`, or 0 when it has to be sent as an
+// event. Return, Tab, Backspace, Delete and Escape are left to VTE since what
+// they write depends on its settings and the terminal modes, and so are the
+// keypad keys.
+static unsigned get_char(const MacroKey* key)
+{
+  if (key->state & ~GDK_SHIFT_MASK) {
+    return 0;
+  }
+  if (GDK_KEY_KP_Space <= key->keyval && key->keyval <= GDK_KEY_KP_9) {
+    return 0;
+  }
+  unsigned c = gdk_keyval_to_unicode(key->keyval);
+  return (c < 0x20 || c == 0x7f) ? 0 : c;
+}
+
+static void flush(Macro* macro, const MacroSink* sink, void* user_data)
+{
+  if (macro->text->len > 0) {
+    sink->feed(macro->text->str, macro->text->len, user_data);
+    g_string_truncate(macro->text, 0);
+  }
+}
+
+bool macro_play(Macro* macro, unsigned count, const MacroSink* sink, void* user_data)
+{
+  if (macro->playing || macro->recording) {
+    return false;
+  }
+  macro->playing = true;
+  for (unsigned n = 0; n < count && !macro->closed; n++) {
+    for (unsigned i = 0; i < macro->keys->len && !macro->closed; i++) {
+      const MacroKey* key = &g_array_index(macro->keys, MacroKey, i);
+      unsigned c = get_char(key);
+      if (c && !sink->is_bound(key, user_data)) {
+        g_string_append_unichar(macro->text, c);
+        continue;
+      }
+      flush(macro, sink, user_data);
+      sink->send(key, user_data);
+    }
+  }
+  if (!macro->closed) {
+    flush(macro, sink, user_data);
+  }
+  macro->playing = false;
+  if (macro->closed) {
+    macro_free(macro);
+    return false;
+  }
+  return true;
+}
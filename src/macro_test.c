@@ -0,0 +1,160 @@
+/**
+ * macro_test.c
+ *
+ * Copyright (c) 2026 endaaman
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license. See the LICENSE file for details.
+ */
+
+#include "tym_test.h"
+#include "macro.h"
+
+typedef struct {
+  Macro* macro;
+  GString* log;
+  unsigned bound;
+  unsigned feeds;
+  bool replayed;
+  bool restarted;
+} Recorder;
+
+static bool is_bound(const MacroKey* key, void* user_data)
+{
+  return key->keyval == ((Recorder*)user_data)->bound;
+}
+
+static void feed(const char* text, size_t length, void* user_data)
+{
+  Recorder* r = (Recorder*)user_data;
+  g_string_append_printf(r->log, "[%.*s]", (int)length, text);
+  r->feeds += 1;
+}
+
+static void send(const MacroKey* key, void* user_data)
+{
+  Recorder* r = (Recorder*)user_data;
+  g_string_append_printf(r->log, "<%s>", gdk_keyval_name(key->keyval));
+}
+
+static void send_and_reenter(const MacroKey* key, void* user_data)
+{
+  Recorder* r = (Recorder*)user_data;
+  MacroSink sink = { is_bound, feed, send };
+  r->replayed = macro_play(r->macro, 1, &sink, r);
+  r->restarted = macro_start(r->macro);
+  macro_record(r->macro, GDK_KEY_z, 0);
+  send(key, user_data);
+}
+
+static void record_keys(Macro* macro)
+{
+  g_assert_true(macro_start(macro));
+  macro_record(macro, GDK_KEY_l, 0);
+  macro_record(macro, GDK_KEY_S, GDK_SHIFT_MASK);
+  macro_record(macro, GDK_KEY_Return, 0);
+  macro_record(macro, GDK_KEY_c, GDK_CONTROL_MASK);
+  macro_record(macro, GDK_KEY_BackSpace, 0);
+  macro_record(macro, GDK_KEY_KP_1, 0);
+  macro_record(macro, GDK_KEY_eacute, 0);
+  g_assert_cmpuint(macro_stop(macro), ==, 7);
+}
+
+static void test_record()
+{
+  Macro* macro = macro_init();
+  macro_record(macro, GDK_KEY_a, 0);
+  g_assert_cmpuint(macro_get_length(macro), ==, 0);
+
+  record_keys(macro);
+  g_assert_false(macro_is_recording(macro));
+  macro_record(macro, GDK_KEY_a, 0);
+  g_assert_cmpuint(macro_get_length(macro), ==, 7);
+
+  // Starting again drops the previous one
+  g_assert_true(macro_start(macro));
+  g_assert_true(macro_is_recording(macro));
+  g_assert_cmpuint(macro_stop(macro), ==, 0);
+  macro_close(macro);
+}
+
+static void test_play()
+{
+  Macro* macro = macro_init();
+  Recorder r = { .macro = macro, .log = g_string_new(NULL) };
+  MacroSink sink = { is_bound, feed, send };
+
+  record_keys(macro);
+  g_assert_true(macro_play(macro, 2, &sink, &r));
+  g_assert_cmpstr(r.log->str, ==,
+      "[lS]<Return><c><BackSpace><KP_1>[\xc3\xa9lS]<Return><c><BackSpace><KP_1>[\xc3\xa9]");
+  g_assert_cmpuint(r.feeds, ==, 3);
+
+  // A bound key is sent as an event even when it types a character
+  g_string_truncate(r.log, 0);
+  r.bound = GDK_KEY_S;
+  g_assert_true(macro_play(macro, 1, &sink, &r));
+  g_assert_cmpstr(r.log->str, ==, "[l]<S><Return><c><BackSpace><KP_1>[\xc3\xa9]");
+
+  // Not while recording
+  macro_start(macro);
+  g_assert_false(macro_play(macro, 1, &sink, &r));
+  macro_stop(macro);
+
+  g_string_free(r.log, true);
+  macro_close(macro);
+}
+
+static void test_reenter()
+{
+  Macro* macro = macro_init();
+  Recorder r = { .macro = macro, .log = g_string_new(NULL), .replayed = true, .restarted = true };
+  MacroSink sink = { is_bound, feed, send_and_reenter };
+
+  g_assert_true(macro_start(macro));
+  macro_record(macro, GDK_KEY_x, 0);
+  macro_record(macro, GDK_KEY_Escape, 0);
+  macro_stop(macro);
+
+  g_assert_true(macro_play(macro, 1, &sink, &r));
+  g_assert_false(r.replayed);
+  g_assert_false(r.restarted);
+  g_assert_cmpstr(r.log->str, ==, "[x]<Escape>");
+  g_assert_cmpuint(macro_get_length(macro), ==, 2);
+
+  g_string_free(r.log, true);
+  macro_close(macro);
+}
+
+static void close_while_playing(const MacroKey* key, void* user_data)
+{
+  Recorder* r = (Recorder*)user_data;
+  send(key, user_data);
+  macro_close(r->macro);
+}
+
+static void test_close_while_playing()
+{
+  Macro* macro = macro_init();
+  Recorder r = { .macro = macro, .log = g_string_new(NULL) };
+  MacroSink sink = { is_bound, feed, close_while_playing };
+
+  macro_start(macro);
+  macro_record(macro, GDK_KEY_Tab, GDK_CONTROL_MASK);
+  macro_record(macro, GDK_KEY_a, 0);
+  macro_stop(macro);
+
+  // Nothing is played after the macro is closed, which frees it on return
+  g_assert_false(macro_play(macro, 3, &sink, &r));
+  g_assert_cmpstr(r.log->str, ==, "<Tab>");
+
+  g_string_free(r.log, true);
+}
+
+void test_macro()
+{
+  test_record();
+  test_play();
+  test_reenter();
+  test_close_while_playing();
+}
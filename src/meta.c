@@ -176,6 +176,11 @@ Meta* meta_init()
       .arg_desc="<int>", .desc="Scrollback buffer length",
       .getter=CB(getter_scrollback_length), .setter=CB(setter_scrollback_length)
     },
+    {
+      .name="lua_timeout", .type=T_INT, .default_value=memdup(&v_zero, sizeof(int)),
+      .arg_desc="<int>", .desc="Milliseconds a Lua callback may run before it is aborted (0: no limit)",
+      .getter=CB(getter_lua_timeout), .setter=CB(setter_lua_timeout)
+    },
     // BOOL
     {
       .name="scroll_on_output", .type=T_BOOL, .default_value=memdup(&v_false, sizeof(bool)),
@@ -186,6 +191,10 @@ Meta* meta_init()
       .name="ignore_default_keymap", .type=T_BOOL, .default_value=memdup(&v_false, sizeof(bool)),
       .desc="Whether to use default keymap",
     },
+    {
+      .name="coalesce_scroll", .type=T_BOOL, .default_value=memdup(&v_false, sizeof(bool)),
+      .desc="Whether to deliver the scroll hook once per frame",
+    },
     {
       .name="autohide", .type=T_BOOL, .default_value=memdup(&v_false, sizeof(bool)),
       .desc="Whether to hide mouse cursor when key is pressed",
@@ -201,6 +210,11 @@ Meta* meta_init()
       .desc="Whether to make bold texts bright",
       .getter=CB(gettter_bold_is_bright), .setter=CB(setter_bold_is_bright),
     },
+    {
+      .name="profile", .type=T_BOOL, .default_value=memdup(&v_false, sizeof(bool)),
+      .desc="Whether to record the time spent in Lua callbacks",
+      .getter=CB(getter_profile), .setter=CB(setter_profile),
+    },
     {
       .name="osc_clipboard", .type=T_BOOL, .default_value=memdup(&v_false, sizeof(bool)),
       .desc="Whether to let the application write the clipboard (requires VTE >= 0.78)",
@@ -273,20 +287,13 @@ MetaEntry* meta_get_entry(Meta* meta, const char* key)
   return NULL;
 }
 
-static void* new_empty_bool()
-{
-  return g_new0(gboolean, 1);
-}
-
-static void* new_empty_str()
-{
-  return g_new0(char*, 1);
-}
-
-static void* new_empty_int()
-{
-  return g_new0(int, 1);
-}
+// Storage for the value of an option. Every entry gets one slot, and all the
+// slots are allocated together with the entries, which are freed at once.
+typedef union {
+  gboolean b;
+  int i;
+  char* s;
+} OptionValue;
 
 GOptionEntry* meta_get_option_entries(Meta* meta)
 {
@@ -295,83 +302,74 @@ GOptionEntry* meta_get_option_entries(Meta* meta)
       .long_name = "version",
       .short_name = 'v',
       .arg = G_OPTION_ARG_NONE,
-      .arg_data = new_empty_bool(),
       .description = "Show version",
       .arg_description = NULL,
     }, {
       .long_name = "daemon",
       .arg = G_OPTION_ARG_NONE,
-      .arg_data = new_empty_bool(),
       .description = "Launch as daemon process",
       .arg_description = NULL,
     }, {
       .long_name = "use",
       .short_name = 'u',
       .arg = G_OPTION_ARG_STRING,
-      .arg_data = new_empty_str(),
       .description = "<path> to config file. Set '" TYM_SYMBOL_NONE "' to start without loading config",
       .arg_description = "<path>",
     }, {
       .long_name = "theme",
       .short_name = 't',
       .arg = G_OPTION_ARG_STRING,
-      .arg_data = new_empty_str(),
       .description = "<path> to theme file. Set '" TYM_SYMBOL_NONE "' to start without loading theme",
       .arg_description = "<path>",
     }, {
       .long_name = "id",
       .short_name = 'i',
       .arg = G_OPTION_ARG_INT,
-      .arg_data = new_empty_int(),
       .description = "<id> to use in the new instance",
       .arg_description = "<id>",
     }, {
       .long_name = "signal",
       .short_name = 's',
       .arg = G_OPTION_ARG_STRING,
-      .arg_data = new_empty_str(),
       .description = "<signal name> to send via DBus",
       .arg_description = "<signal name>",
     }, {
       .long_name = "call",
       .short_name = 'c',
       .arg = G_OPTION_ARG_STRING,
-      .arg_data = new_empty_str(),
       .description = "<method name> to call via DBus",
       .arg_description = "<method name>",
     }, {
       .long_name = "param",
       .short_name = 'p',
       .arg = G_OPTION_ARG_STRING,
-      .arg_data = new_empty_str(),
       .description = "param with which is called method via DBus",
       .arg_description = "<param>",
     }, {
       .long_name = "dest",
       .short_name = 'd',
       .arg = G_OPTION_ARG_STRING,
-      .arg_data = new_empty_str(),
       .description = "<dest id> to send signal/call method($TYM_ID is default)",
       .arg_description = "<dest id>",
     }, {
       .long_name = "isolated",
       .arg = G_OPTION_ARG_NONE,
-      .arg_data = new_empty_bool(),
       .description = "Start as an isolated instance",
       .arg_description = NULL,
     }, {
       .long_name = "cwd",
       .arg = G_OPTION_ARG_STRING,
-      .arg_data = new_empty_str(),
       .description = "Set the terminal's working directory. Must be an absolute path.",
       .arg_description = "<path>",
     }
   };
 
-  GOptionEntry* options_entries = (GOptionEntry*)g_new0(
-      GOptionEntry,
-      sizeof(app_options) / sizeof(GOptionEntry) + meta_size(meta) + 1
+  unsigned count = sizeof(app_options) / sizeof(GOptionEntry) + meta_size(meta);
+  // entries (terminated by an empty one) followed by their value slots
+  GOptionEntry* options_entries = (GOptionEntry*)g_malloc0(
+      sizeof(GOptionEntry) * (count + 1) + sizeof(OptionValue) * count
   );
+  OptionValue* values = (OptionValue*)&options_entries[count + 1];
   memmove(options_entries, app_options, sizeof(app_options));
   unsigned i = sizeof(app_options) / sizeof(GOptionEntry);
 
@@ -387,22 +385,21 @@ GOptionEntry* meta_get_option_entries(Meta* meta)
     switch (me->type) {
       case META_ENTRY_TYPE_STRING:
         e->arg = G_OPTION_ARG_STRING;
-        e->arg_data = new_empty_str();
         break;
       case META_ENTRY_TYPE_INTEGER:
         e->arg = G_OPTION_ARG_INT;
-        e->arg_data = new_empty_int();
         break;
       case META_ENTRY_TYPE_BOOLEAN:
         e->arg = G_OPTION_ARG_NONE;
-        e->arg_data = new_empty_bool();
         break;
       case META_ENTRY_TYPE_NONE:
         // used for help text
         e->arg = G_OPTION_ARG_INT;
-        e->arg_data = new_empty_int();
         break;
     }
   }
+  for (i = 0; i < count; i++) {
+    options_entries[i].arg_data = &values[i];
+  }
   return options_entries;
 }
@@ -36,13 +36,16 @@ void option_close(Option* option)
   if (option->entries) {
     GOptionEntry* e = &option->entries[0];
     while (e->long_name) {
-      if (e->arg_data) {
-        g_free(e->arg_data);
+      /* strings are the only values GOption allocates */
+      if (e->arg == G_OPTION_ARG_STRING) {
+        g_free(*(char**)e->arg_data);
       }
       e++;
     };
+    /* the value slots live in the same block as the entries */
     g_free(option->entries);
   }
+  g_strfreev(option->rest_argv);
   if (option->entries_as_table) {
     g_hash_table_destroy(option->entries_as_table);
   }
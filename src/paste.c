@@ -0,0 +1,259 @@
+/**
+ * paste.c
+ *
+ * Copyright (c) 2026 endaaman
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license. See the LICENSE file for details.
+ */
+
+#include <glib-unix.h>
+#include "paste.h"
+
+
+// The text is queued in `buffer` and handed to VTE a chunk at a time whenever
+// the PTY can take more, so that a large paste does not freeze the window.
+// This is only a rough pace: VTE keeps its own write queue, and the PTY is
+// writable whenever it has any room, so a chunk can still be queued in VTE
+// before the last one has been read. Going through VTE's queue keeps keys
+// typed meanwhile out of the middle of a chunk, but not out of the middle of
+// a bracketed paste spanning several chunks. Pastes started while one is
+// going on are queued after it. Clipboard requests are answered
+// asynchronously, so each one holds a PasteRequest which is detached when the
+// paste is closed. Until the requests before it are answered, text is kept in
+// `requests` as an answered one, so that everything is written in the order
+// it was asked for. `brackets` has the span of each bracketed paste in
+// `buffer`, so that cancelling one halfway can still end it.
+
+#define TYM_PASTE_BRACKET_START "\033[200~"
+#define TYM_PASTE_BRACKET_END "\033[201~"
+
+typedef struct {
+  Paste* paste;
+  bool bracketed;
+  bool answered;
+  char* text;
+} PasteRequest;
+
+typedef struct {
+  size_t start;
+  size_t end;
+} PasteBracket;
+
+
+Paste* paste_init(VteTerminal* vte)
+{
+  Paste* paste = g_new0(Paste, 1);
+  paste->vte = vte;
+  paste->buffer = g_string_new(NULL);
+  paste->brackets = g_array_new(false, false, sizeof(PasteBracket));
+  return paste;
+}
+
+static void paste_clear(Paste* paste)
+{
+  g_string_truncate(paste->buffer, 0);
+  g_array_set_size(paste->brackets, 0);
+  paste->written = 0;
+  paste->watch_id = 0;
+}
+
+static void paste_drop(Paste* paste)
+{
+  if (paste->watch_id) {
+    g_source_remove(paste->watch_id);
+  }
+  paste_clear(paste);
+  for (GSList* li = paste->requests; li != NULL; li = li->next) {
+    PasteRequest* request = (PasteRequest*)li->data;
+    if (request->answered) {
+      g_free(request->text);
+      g_free(request);
+    } else {
+      // freed when the clipboard answers
+      request->paste = NULL;
+    }
+  }
+  g_slist_free(paste->requests);
+  paste->requests = NULL;
+}
+
+// The PTY goes away with the window, so bracketed pastes are not ended here.
+void paste_close(Paste* paste)
+{
+  paste_drop(paste);
+  g_string_free(paste->buffer, true);
+  g_array_unref(paste->brackets);
+  g_free(paste);
+}
+
+// Not to split a character between the chunks which other input can come in
+static size_t get_chunk_size(Paste* paste)
+{
+  size_t rest = paste->buffer->len - paste->written;
+  if (rest <= TYM_PASTE_CHUNK_SIZE) {
+    return rest;
+  }
+  const char* chunk = paste->buffer->str + paste->written;
+  size_t size = TYM_PASTE_CHUNK_SIZE;
+  while (size > 0 && (chunk[size] & 0xc0) == 0x80) {
+    size--;
+  }
+  return size > 0 ? size : TYM_PASTE_CHUNK_SIZE;
+}
+
+static int on_pty_writable(int fd, GIOCondition condition, void* user_data)
+{
+  Paste* paste = (Paste*)user_data;
+  if (condition & (G_IO_ERR | G_IO_HUP | G_IO_NVAL)) {
+    paste_clear(paste);
+    return G_SOURCE_REMOVE;
+  }
+  size_t size = get_chunk_size(paste);
+  vte_terminal_feed_child(paste->vte, paste->buffer->str + paste->written, size);
+  paste->written += size;
+  if (paste->written < paste->buffer->len) {
+    return G_SOURCE_CONTINUE;
+  }
+  paste_clear(paste);
+  return G_SOURCE_REMOVE;
+}
+
+// The end marker is dropped from the text, or the rest of the text would be
+// taken as typed in.
+static void append_bracketed(GString* buffer, const char* text)
+{
+  g_string_append(buffer, TYM_PASTE_BRACKET_START);
+  const char* p = text;
+  const char* found = NULL;
+  while ((found = strstr(p, TYM_PASTE_BRACKET_END))) {
+    g_string_append_len(buffer, p, found - p);
+    p = found + strlen(TYM_PASTE_BRACKET_END);
+  }
+  g_string_append(buffer, p);
+  g_string_append(buffer, TYM_PASTE_BRACKET_END);
+}
+
+static void paste_write(Paste* paste, const char* text, bool bracketed)
+{
+  if (!text || is_empty(text)) {
+    return;
+  }
+  VtePty* pty = vte_terminal_get_pty(paste->vte);
+  if (!pty) {
+    return;
+  }
+  if (bracketed) {
+    PasteBracket bracket = { .start = paste->buffer->len };
+    append_bracketed(paste->buffer, text);
+    bracket.end = paste->buffer->len;
+    g_array_append_val(paste->brackets, bracket);
+  } else {
+    g_string_append(paste->buffer, text);
+  }
+  if (!paste->watch_id) {
+    paste->watch_id = g_unix_fd_add(vte_pty_get_fd(pty), G_IO_OUT, on_pty_writable, paste);
+  }
+}
+
+static PasteRequest* paste_queue(Paste* paste, bool bracketed)
+{
+  PasteRequest* request = g_new0(PasteRequest, 1);
+  request->paste = paste;
+  request->bracketed = bracketed;
+  paste->requests = g_slist_append(paste->requests, request);
+  return request;
+}
+
+// Writes the answered requests from the head up to the first one waiting
+static void paste_flush_requests(Paste* paste)
+{
+  while (paste->requests) {
+    PasteRequest* request = (PasteRequest*)paste->requests->data;
+    if (!request->answered) {
+      return;
+    }
+    paste->requests = g_slist_delete_link(paste->requests, paste->requests);
+    paste_write(paste, request->text, request->bracketed);
+    g_free(request->text);
+    g_free(request);
+  }
+}
+
+void paste_append(Paste* paste, const char* text, bool bracketed)
+{
+  if (!paste->requests) {
+    paste_write(paste, text, bracketed);
+    return;
+  }
+  PasteRequest* request = paste_queue(paste, bracketed);
+  request->text = g_strdup(text);
+  request->answered = true;
+}
+
+static void on_clipboard_text(GtkClipboard* clipboard, const char* text, void* user_data)
+{
+  PasteRequest* request = (PasteRequest*)user_data;
+  Paste* paste = request->paste;
+  if (!paste) {
+    g_free(request);
+    return;
+  }
+  request->text = g_strdup(text);
+  request->answered = true;
+  paste_flush_requests(paste);
+}
+
+void paste_request(Paste* paste, GdkAtom selection, bool bracketed)
+{
+  PasteRequest* request = paste_queue(paste, bracketed);
+  gtk_clipboard_request_text(gtk_clipboard_get(selection), on_clipboard_text, request);
+}
+
+// When a bracketed paste has been written partway, writes what is left of its
+// markers so that the program does not stay in the paste mode.
+static void paste_end_bracket(Paste* paste)
+{
+  size_t start_length = strlen(TYM_PASTE_BRACKET_START);
+  size_t end_length = strlen(TYM_PASTE_BRACKET_END);
+  for (unsigned i = 0; i < paste->brackets->len; i++) {
+    PasteBracket* b = &g_array_index(paste->brackets, PasteBracket, i);
+    if (paste->written <= b->start || b->end <= paste->written) {
+      continue;
+    }
+    GString* rest = g_string_new(NULL);
+    if (paste->written < b->start + start_length) {
+      g_string_append(rest, TYM_PASTE_BRACKET_START + (paste->written - b->start));
+    }
+    if (paste->written > b->end - end_length) {
+      g_string_append_len(rest, paste->buffer->str + paste->written, b->end - paste->written);
+    } else {
+      g_string_append(rest, TYM_PASTE_BRACKET_END);
+    }
+    vte_terminal_feed_child(paste->vte, rest->str, rest->len);
+    g_string_free(rest, true);
+    return;
+  }
+}
+
+// Drops the text not written yet, and the clipboard requests not answered yet.
+// Returns whether anything was cancelled.
+bool paste_cancel(Paste* paste)
+{
+  bool active = paste_is_active(paste);
+  paste_end_bracket(paste);
+  paste_drop(paste);
+  return active;
+}
+
+bool paste_is_active(Paste* paste)
+{
+  return paste->watch_id || paste->requests;
+}
+
+// In bytes, including the brackets
+void paste_get_progress(Paste* paste, size_t* written, size_t* total)
+{
+  *written = paste->written;
+  *total = paste->buffer->len;
+}
@@ -514,6 +514,26 @@ void setter_bold_is_bright(Context* context, const char* key, bool value)
   vte_terminal_set_bold_is_bright(context->layout.vte, value);
 }
 
+int getter_lua_timeout(Context* context, const char* key)
+{
+  return context->lua_timeout;
+}
+
+void setter_lua_timeout(Context* context, const char* key, int value)
+{
+  context->lua_timeout = value;
+}
+
+bool getter_profile(Context* context, const char* key)
+{
+  return context->stats->enabled;
+}
+
+void setter_profile(Context* context, const char* key, bool value)
+{
+  context->stats->enabled = value;
+}
+
 // COLOR
 static void setter_color_special(Context* context, const char* key, const char* value, VteSetColorFunc color_func)
 {
@@ -0,0 +1,121 @@
+/**
+ * registry.c
+ *
+ * Copyright (c) 2026 endaaman
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license. See the LICENSE file for details.
+ */
+
+#include "registry.h"
+
+
+#define REGISTRY_WORD_BITS (sizeof(gulong) * 8)
+
+// Items are looked up by id in `table`. `bits` tells which ids are taken so
+// that the lowest free one is found a word at a time. It only covers the ids
+// handed out so far, while an id given explicitly (`--id`) may be far beyond
+// them; such an id is only in `table` until the bitmap grows up to it.
+
+
+Registry* registry_init()
+{
+  Registry* registry = g_new0(Registry, 1);
+  registry->table = g_hash_table_new(g_direct_hash, g_direct_equal);
+  registry->bits = g_array_new(false, true, sizeof(gulong));
+  return registry;
+}
+
+void registry_close(Registry* registry)
+{
+  g_hash_table_destroy(registry->table);
+  g_array_unref(registry->bits);
+  g_free(registry);
+}
+
+static void registry_set_bit(Registry* registry, int id, bool value)
+{
+  if (id >= registry->bits->len * REGISTRY_WORD_BITS) {
+    return;
+  }
+  gulong* word = &g_array_index(registry->bits, gulong, id / REGISTRY_WORD_BITS);
+  gulong mask = 1UL << (id % REGISTRY_WORD_BITS);
+  if (value) {
+    *word |= mask;
+  } else {
+    *word &= ~mask;
+  }
+}
+
+// The lowest id which is not taken. It is not taken by this call.
+int registry_acquire_id(Registry* registry)
+{
+  unsigned i = 0;
+  while (true) {
+    if (i == registry->bits->len) {
+      // grow by a word and take over the ids given beyond the bitmap
+      gulong word = 0;
+      for (unsigned b = 0; b < REGISTRY_WORD_BITS; b++) {
+        if (g_hash_table_contains(registry->table, GINT_TO_POINTER(i * REGISTRY_WORD_BITS + b))) {
+          word |= 1UL << b;
+        }
+      }
+      g_array_append_val(registry->bits, word);
+    }
+    gulong word = g_array_index(registry->bits, gulong, i);
+    int bit = g_bit_nth_lsf(~word, -1);
+    if (bit >= 0) {
+      return i * REGISTRY_WORD_BITS + bit;
+    }
+    i += 1;
+  }
+}
+
+bool registry_add(Registry* registry, int id, void* item)
+{
+  if (id < 0 || g_hash_table_contains(registry->table, GINT_TO_POINTER(id))) {
+    return false;
+  }
+  g_hash_table_insert(registry->table, GINT_TO_POINTER(id), item);
+  registry_set_bit(registry, id, true);
+  return true;
+}
+
+bool registry_remove(Registry* registry, int id)
+{
+  if (!g_hash_table_remove(registry->table, GINT_TO_POINTER(id))) {
+    return false;
+  }
+  registry_set_bit(registry, id, false);
+  return true;
+}
+
+void* registry_lookup(Registry* registry, int id)
+{
+  return g_hash_table_lookup(registry->table, GINT_TO_POINTER(id));
+}
+
+unsigned registry_size(Registry* registry)
+{
+  return g_hash_table_size(registry->table);
+}
+
+static int registry_compare_ids(const void* a, const void* b)
+{
+  return *(const int*)a - *(const int*)b;
+}
+
+// All the ids in ascending order. Free it with `g_array_unref()`.
+GArray* registry_get_ids(Registry* registry)
+{
+  GArray* ids = g_array_sized_new(false, false, sizeof(int), registry_size(registry));
+  GHashTableIter iter;
+  void* key = NULL;
+  g_hash_table_iter_init(&iter, registry->table);
+  while (g_hash_table_iter_next(&iter, &key, NULL)) {
+    int id = GPOINTER_TO_INT(key);
+    g_array_append_val(ids, id);
+  }
+  g_array_sort(ids, registry_compare_ids);
+  return ids;
+}
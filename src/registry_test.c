@@ -0,0 +1,75 @@
+/**
+ * registry_test.c
+ *
+ * Copyright (c) 2026 endaaman
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license. See the LICENSE file for details.
+ */
+
+#include "tym_test.h"
+#include "registry.h"
+
+static void test_acquire()
+{
+  Registry* r = registry_init();
+  int items[200] = {0};
+
+  g_assert_cmpint(registry_acquire_id(r), ==, 0);
+  for (int i = 0; i < 200; i++) {
+    int id = registry_acquire_id(r);
+    g_assert_cmpint(id, ==, i);
+    g_assert(registry_add(r, id, &items[i]));
+  }
+  g_assert_cmpuint(registry_size(r), ==, 200);
+
+  // the lowest freed id is reused first
+  g_assert(registry_remove(r, 130));
+  g_assert(registry_remove(r, 5));
+  g_assert_false(registry_remove(r, 5));
+  g_assert_cmpint(registry_acquire_id(r), ==, 5);
+  g_assert(registry_add(r, 5, &items[5]));
+  g_assert_cmpint(registry_acquire_id(r), ==, 130);
+
+  g_assert(registry_lookup(r, 42) == &items[42]);
+  g_assert(registry_lookup(r, 130) == NULL);
+  registry_close(r);
+}
+
+static void test_explicit_id()
+{
+  Registry* r = registry_init();
+  int a = 0, b = 0;
+
+  g_assert(registry_add(r, 1, &a));
+  g_assert_false(registry_add(r, 1, &b));
+  g_assert_false(registry_add(r, -1, &b));
+  g_assert_cmpint(registry_acquire_id(r), ==, 0);
+  g_assert(registry_add(r, 0, &b));
+  g_assert_cmpint(registry_acquire_id(r), ==, 2);
+
+  // beyond the bitmap at first, then skipped once the bitmap reaches it
+  g_assert(registry_add(r, 100000, &a));
+  for (int i = 2; i < 100; i++) {
+    g_assert(registry_add(r, registry_acquire_id(r), &b));
+  }
+  g_assert(registry_add(r, 101, &a));
+  g_assert_cmpint(registry_acquire_id(r), ==, 100);
+  g_assert(registry_add(r, 100, &b));
+  g_assert_cmpint(registry_acquire_id(r), ==, 102);
+
+  GArray* ids = registry_get_ids(r);
+  g_assert_cmpuint(ids->len, ==, registry_size(r));
+  for (unsigned i = 1; i < ids->len; i++) {
+    g_assert_cmpint(g_array_index(ids, int, i - 1), <, g_array_index(ids, int, i));
+  }
+  g_assert_cmpint(g_array_index(ids, int, ids->len - 1), ==, 100000);
+  g_array_unref(ids);
+  registry_close(r);
+}
+
+void test_registry()
+{
+  test_acquire();
+  test_explicit_id();
+}
@@ -0,0 +1,180 @@
+/**
+ * screen.c
+ *
+ * Copyright (c) 2026 endaaman
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license. See the LICENSE file for details.
+ */
+
+#include "screen.h"
+
+
+// The rows currently on screen, top first, read out of VTE in one go. Every
+// row is kept NUL-terminated in the single buffer `text`, and `rows` tells
+// where each of them starts. A row is `wrapped` when the line goes on in the
+// next row without a line break, that is VTE wrapped it by itself.
+
+
+static glong screen_cell_width(gunichar c, bool cjk_wide)
+{
+  if (g_unichar_iszerowidth(c)) {
+    return 0;
+  }
+  if (cjk_wide ? g_unichar_iswide_cjk(c) : g_unichar_iswide(c)) {
+    return 2;
+  }
+  return 1;
+}
+
+static void screen_add_row(Screen* screen, const char* head, size_t length, bool wrapped)
+{
+  ScreenRow row = { .start = screen->text->len, .length = length, .wrapped = wrapped };
+  g_string_append_len(screen->text, head, length);
+  g_string_append_c(screen->text, '\0');
+  g_array_append_val(screen->rows, row);
+}
+
+// Cut a line into the rows it occupies on screen. VTE reports a paragraph
+// soft-wrapped by itself as a single line, so anything wider than the screen
+// is put back on the grid of the cells.
+static void screen_add_line(Screen* screen, const char* line, size_t length)
+{
+  const char* end = line + length;
+  const char* head = line;
+  glong width = 0;
+  bool wrapped = false;
+  for (const char* p = line; p < end; p = g_utf8_next_char(p)) {
+    width += screen_cell_width(g_utf8_get_char(p), screen->cjk_wide);
+    if (width >= screen->cols) {
+      const char* next = g_utf8_next_char(p);
+      if (next < end) {
+        screen_add_row(screen, head, next - head, true);
+      } else {
+        // exactly as wide as the screen
+        screen_add_row(screen, head, next - head, false);
+      }
+      head = next;
+      width = 0;
+      wrapped = true;
+    }
+  }
+  if (head < end || !wrapped) {
+    screen_add_row(screen, head, end - head, false);
+  }
+}
+
+Screen* screen_init_from_text(const char* text, glong cols, bool cjk_wide)
+{
+  if (!text || cols <= 0) {
+    return NULL;
+  }
+  Screen* screen = g_new0(Screen, 1);
+  screen->text = g_string_sized_new(strlen(text) + 64);
+  screen->rows = g_array_new(false, false, sizeof(ScreenRow));
+  screen->cols = cols;
+  screen->cjk_wide = cjk_wide;
+  const char* line = text;
+  while (true) {
+    const char* br = strchr(line, '\n');
+    if (!br) {
+      // the text ends with a line break, which is not a row of its own
+      if (*line || screen->rows->len == 0) {
+        screen_add_line(screen, line, strlen(line));
+      }
+      break;
+    }
+    screen_add_line(screen, line, br - line);
+    line = br + 1;
+  }
+  return screen;
+}
+
+// Taken from the visible text as a whole rather than read one row at a time
+// out of the scrollback ring: while the alternate screen is up -- which is
+// where TUI apps live -- the vertical adjustment reports `[0, row_count)`
+// although the ring keeps numbering rows from the scrollback, so row numbers
+// derived from the adjustment address rows that are not the ones on screen.
+Screen* screen_init(VteTerminal* vte)
+{
+  char* text = tym_get_visible_text(vte);
+  Screen* screen = screen_init_from_text(
+    text,
+    vte_terminal_get_column_count(vte),
+    vte_terminal_get_cjk_ambiguous_width(vte) == 2);
+  g_free(text);
+  return screen;
+}
+
+void screen_close(Screen* screen)
+{
+  g_string_free(screen->text, true);
+  g_array_unref(screen->rows);
+  g_free(screen);
+}
+
+unsigned screen_get_row_count(Screen* screen)
+{
+  return screen->rows->len;
+}
+
+// NUL-terminated. NULL when out of range.
+const char* screen_get_row(Screen* screen, unsigned row, size_t* length)
+{
+  if (row >= screen->rows->len) {
+    return NULL;
+  }
+  ScreenRow* r = &g_array_index(screen->rows, ScreenRow, row);
+  if (length) {
+    *length = r->length;
+  }
+  return screen->text->str + r->start;
+}
+
+bool screen_is_wrapped(Screen* screen, unsigned row)
+{
+  return row < screen->rows->len && g_array_index(screen->rows, ScreenRow, row).wrapped;
+}
+
+// Whether the row is filled up to the last column
+bool screen_is_full(Screen* screen, unsigned row)
+{
+  const char* text = screen_get_row(screen, row, NULL);
+  if (!text) {
+    return false;
+  }
+  glong width = 0;
+  for (const char* p = text; *p; p = g_utf8_next_char(p)) {
+    width += screen_cell_width(g_utf8_get_char(p), screen->cjk_wide);
+    if (width >= screen->cols) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// byte offset of the character covering `col`, or -1 when the cell is empty.
+// also reports whether the row is filled up to the last column.
+glong screen_scan_row(Screen* screen, unsigned row, glong col, bool* full)
+{
+  *full = false;
+  const char* text = screen_get_row(screen, row, NULL);
+  if (!text) {
+    return -1;
+  }
+  glong width = 0;
+  glong offset = -1;
+  for (const char* p = text; *p; p = g_utf8_next_char(p)) {
+    glong w = screen_cell_width(g_utf8_get_char(p), screen->cjk_wide);
+    if (offset < 0 && col < width + w) {
+      offset = p - text;
+    }
+    width += w;
+    if (offset >= 0 && width >= screen->cols) {
+      *full = true;
+      return offset;
+    }
+  }
+  *full = width >= screen->cols;
+  return offset;
+}
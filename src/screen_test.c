@@ -0,0 +1,68 @@
+/**
+ * screen_test.c
+ *
+ * Copyright (c) 2026 endaaman
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license. See the LICENSE file for details.
+ */
+
+#include "tym_test.h"
+#include "screen.h"
+
+static void test_rows()
+{
+  Screen* s = screen_init_from_text("abc\n\nabcdefghij\nabcde\n", 5, false);
+  g_assert_cmpuint(screen_get_row_count(s), ==, 5);
+
+  size_t length = 0;
+  g_assert_cmpstr(screen_get_row(s, 0, &length), ==, "abc");
+  g_assert_cmpuint(length, ==, 3);
+  g_assert_cmpstr(screen_get_row(s, 1, NULL), ==, "");
+  // a line wider than the screen is cut into the rows it occupies
+  g_assert_cmpstr(screen_get_row(s, 2, NULL), ==, "abcde");
+  g_assert_cmpstr(screen_get_row(s, 3, NULL), ==, "fghij");
+  g_assert_cmpstr(screen_get_row(s, 4, NULL), ==, "abcde");
+  g_assert_null(screen_get_row(s, 5, NULL));
+
+  g_assert_false(screen_is_wrapped(s, 0));
+  g_assert(screen_is_wrapped(s, 2));
+  g_assert_false(screen_is_wrapped(s, 3));
+  // filled up to the last column but ends with a line break
+  g_assert_false(screen_is_wrapped(s, 4));
+  g_assert(screen_is_full(s, 4));
+  g_assert_false(screen_is_full(s, 0));
+  screen_close(s);
+
+  s = screen_init_from_text("", 5, false);
+  g_assert_cmpuint(screen_get_row_count(s), ==, 1);
+  screen_close(s);
+
+  g_assert_null(screen_init_from_text(NULL, 5, false));
+  g_assert_null(screen_init_from_text("abc", 0, false));
+}
+
+static void test_wide()
+{
+  // "あい" takes 4 columns
+  Screen* s = screen_init_from_text("aあいb", 4, false);
+  g_assert_cmpuint(screen_get_row_count(s), ==, 2);
+  g_assert_cmpstr(screen_get_row(s, 1, NULL), ==, "b");
+
+  bool full = false;
+  g_assert_cmpint(screen_scan_row(s, 0, 0, &full), ==, 0);
+  g_assert(full);
+  // both cells of a wide character point at it
+  g_assert_cmpint(screen_scan_row(s, 0, 1, &full), ==, 1);
+  g_assert_cmpint(screen_scan_row(s, 0, 2, &full), ==, 1);
+  g_assert_cmpint(screen_scan_row(s, 1, 0, &full), ==, 0);
+  g_assert_false(full);
+  g_assert_cmpint(screen_scan_row(s, 1, 2, &full), ==, -1);
+  screen_close(s);
+}
+
+void test_screen()
+{
+  test_rows();
+  test_wide();
+}
@@ -0,0 +1,75 @@
+/**
+ * stats.c
+ *
+ * Copyright (c) 2026 endaaman
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license. See the LICENSE file for details.
+ */
+
+#include "stats.h"
+
+
+// Entries are keyed by "<category>:<name>" like "hook:title", or by the
+// category alone when there is no name. Durations are
+// in microseconds of wall time.
+#define TYM_STATS_KEY_MAX 256
+
+
+Stats* stats_init()
+{
+  Stats* stats = g_new0(Stats, 1);
+  stats->entries = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+  return stats;
+}
+
+void stats_close(Stats* stats)
+{
+  g_hash_table_destroy(stats->entries);
+  g_free(stats);
+}
+
+void stats_reset(Stats* stats)
+{
+  g_hash_table_remove_all(stats->entries);
+}
+
+// Returns 0 when disabled so that `stats_end()` does nothing.
+gint64 stats_begin(Stats* stats)
+{
+  if (!stats || !stats->enabled) {
+    return 0;
+  }
+  return g_get_monotonic_time();
+}
+
+void stats_end(Stats* stats, const char* category, const char* name, gint64 started_at)
+{
+  if (!started_at) {
+    return;
+  }
+  stats_add(stats, category, name, g_get_monotonic_time() - started_at);
+}
+
+void stats_add(Stats* stats, const char* category, const char* name, gint64 duration)
+{
+  if (!stats || !stats->enabled) {
+    return;
+  }
+  char key[TYM_STATS_KEY_MAX];
+  if (name) {
+    g_snprintf(key, sizeof(key), "%s:%s", category, name);
+  } else {
+    g_strlcpy(key, category, sizeof(key));
+  }
+  StatsEntry* e = g_hash_table_lookup(stats->entries, key);
+  if (!e) {
+    e = g_new0(StatsEntry, 1);
+    g_hash_table_insert(stats->entries, g_strdup(key), e);
+  }
+  e->count += 1;
+  e->total += duration;
+  if (duration > e->max) {
+    e->max = duration;
+  }
+}
@@ -0,0 +1,42 @@
+/**
+ * stats_test.c
+ *
+ * Copyright (c) 2026 endaaman
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license. See the LICENSE file for details.
+ */
+
+#include "tym_test.h"
+#include "stats.h"
+
+void test_stats()
+{
+  Stats* stats = stats_init();
+
+  g_assert_cmpint(stats_begin(stats), ==, 0);
+  stats_add(stats, "hook", "title", 10);
+  g_assert_cmpuint(g_hash_table_size(stats->entries), ==, 0);
+
+  stats->enabled = true;
+  stats_add(stats, "hook", "title", 10);
+  stats_add(stats, "hook", "title", 30);
+  stats_add(stats, "keymap", "<Ctrl>a c", 5);
+  StatsEntry* e = g_hash_table_lookup(stats->entries, "hook:title");
+  g_assert_nonnull(e);
+  g_assert_cmpuint(e->count, ==, 2);
+  g_assert_cmpint(e->total, ==, 40);
+  g_assert_cmpint(e->max, ==, 30);
+  g_assert_nonnull(g_hash_table_lookup(stats->entries, "keymap:<Ctrl>a c"));
+
+  gint64 started_at = stats_begin(stats);
+  g_assert_cmpint(started_at, >, 0);
+  stats_end(stats, "timeout", NULL, started_at);
+  e = g_hash_table_lookup(stats->entries, "timeout");
+  g_assert_nonnull(e);
+  g_assert_cmpuint(e->count, ==, 1);
+
+  stats_reset(stats);
+  g_assert_cmpuint(g_hash_table_size(stats->entries), ==, 0);
+  stats_close(stats);
+}
@@ -0,0 +1,204 @@
+/**
+ * timer.c
+ *
+ * Copyright (c) 2026 endaaman
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license. See the LICENSE file for details.
+ */
+
+#include "timer.h"
+
+
+// Timers of all the contexts are kept in one queue ordered by deadline, and a
+// single GSource is armed for the earliest one. Deadlines are rounded up to a
+// multiple of `slack` milliseconds, so that timers falling due close to each
+// other are run in one wakeup.
+
+
+static void timer_free(Timer* timer)
+{
+  if (timer->destroy) {
+    timer->destroy(timer->data);
+  }
+  g_free(timer);
+}
+
+static int timer_compare(const void* a, const void* b, void* user_data)
+{
+  const Timer* x = (const Timer*)a;
+  const Timer* y = (const Timer*)b;
+  if (x->deadline != y->deadline) {
+    return x->deadline < y->deadline ? -1 : 1;
+  }
+  return x->id < y->id ? -1 : (x->id > y->id);
+}
+
+static gint64 timer_wheel_round(TimerWheel* wheel, gint64 deadline)
+{
+  gint64 slack = (gint64)wheel->slack * 1000;
+  if (slack <= 0) {
+    return deadline;
+  }
+  return (deadline + slack - 1) / slack * slack;
+}
+
+static void timer_wheel_rearm(TimerWheel* wheel)
+{
+  if (wheel->source) {
+    g_source_set_ready_time(wheel->source, timer_wheel_get_next_deadline(wheel));
+  }
+}
+
+static int timer_wheel_source_dispatch(GSource* source, GSourceFunc callback, void* user_data)
+{
+  return callback(user_data);
+}
+
+static GSourceFuncs timer_wheel_source_funcs = {
+  NULL,
+  NULL,
+  timer_wheel_source_dispatch,
+  NULL,
+};
+
+static int timer_wheel_on_ready(void* user_data)
+{
+  TimerWheel* wheel = (TimerWheel*)user_data;
+  timer_wheel_dispatch(wheel, g_get_monotonic_time());
+  return G_SOURCE_CONTINUE;
+}
+
+TimerWheel* timer_wheel_init(unsigned slack)
+{
+  TimerWheel* wheel = g_new0(TimerWheel, 1);
+  wheel->queue = g_sequence_new(NULL);
+  wheel->timers = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, (GDestroyNotify)timer_free);
+  wheel->slack = slack;
+  return wheel;
+}
+
+void timer_wheel_close(TimerWheel* wheel)
+{
+  if (wheel->source) {
+    g_source_destroy(wheel->source);
+    g_source_unref(wheel->source);
+  }
+  g_sequence_free(wheel->queue);
+  g_hash_table_destroy(wheel->timers);
+  g_free(wheel);
+}
+
+static void timer_schedule(TimerWheel* wheel, Timer* timer, gint64 now)
+{
+  timer->deadline = timer_wheel_round(wheel, now + (gint64)timer->interval * 1000);
+  timer->iter = g_sequence_insert_sorted(wheel->queue, timer, timer_compare, NULL);
+}
+
+// `interval` is in milliseconds. The source is attached to the default main
+// context on the first call.
+unsigned timer_add(TimerWheel* wheel, void* owner, unsigned interval, TimerFunc func, void* data, GDestroyNotify destroy)
+{
+  if (!wheel->source) {
+    wheel->source = g_source_new(&timer_wheel_source_funcs, sizeof(GSource));
+    g_source_set_callback(wheel->source, timer_wheel_on_ready, wheel, NULL);
+    g_source_set_ready_time(wheel->source, -1);
+    g_source_attach(wheel->source, NULL);
+  }
+  Timer* timer = g_new0(Timer, 1);
+  do {
+    wheel->last_id += 1;
+  } while (!wheel->last_id || g_hash_table_contains(wheel->timers, GUINT_TO_POINTER(wheel->last_id)));
+  timer->id = wheel->last_id;
+  timer->owner = owner;
+  timer->interval = interval;
+  timer->func = func;
+  timer->data = data;
+  timer->destroy = destroy;
+  g_hash_table_insert(wheel->timers, GUINT_TO_POINTER(timer->id), timer);
+  timer_schedule(wheel, timer, g_get_monotonic_time());
+  timer_wheel_rearm(wheel);
+  return timer->id;
+}
+
+static void timer_cancel(TimerWheel* wheel, Timer* timer)
+{
+  if (!timer->iter) {
+    // being dispatched. It is freed once the dispatch is done with it.
+    timer->cancelled = true;
+    return;
+  }
+  g_sequence_remove(timer->iter);
+  g_hash_table_remove(wheel->timers, GUINT_TO_POINTER(timer->id));
+}
+
+// Only removes a timer of `owner`.
+bool timer_remove(TimerWheel* wheel, unsigned id, void* owner)
+{
+  Timer* timer = g_hash_table_lookup(wheel->timers, GUINT_TO_POINTER(id));
+  if (!timer || timer->owner != owner || timer->cancelled) {
+    return false;
+  }
+  timer_cancel(wheel, timer);
+  timer_wheel_rearm(wheel);
+  return true;
+}
+
+void timer_remove_by_owner(TimerWheel* wheel, void* owner)
+{
+  GList* timers = g_hash_table_get_values(wheel->timers);
+  for (GList* li = timers; li != NULL; li = li->next) {
+    Timer* timer = (Timer*)li->data;
+    if (timer->owner == owner && !timer->cancelled) {
+      timer_cancel(wheel, timer);
+    }
+  }
+  g_list_free(timers);
+  timer_wheel_rearm(wheel);
+}
+
+// -1 when there is no timer
+gint64 timer_wheel_get_next_deadline(TimerWheel* wheel)
+{
+  GSequenceIter* first = g_sequence_get_begin_iter(wheel->queue);
+  if (g_sequence_iter_is_end(first)) {
+    return -1;
+  }
+  return ((Timer*)g_sequence_get(first))->deadline;
+}
+
+void timer_wheel_dispatch(TimerWheel* wheel, gint64 now)
+{
+  // Timers to run again are queued after the loop, so that a zero interval
+  // does not make them run forever in this dispatch.
+  GSList* again = NULL;
+  while (true) {
+    GSequenceIter* first = g_sequence_get_begin_iter(wheel->queue);
+    if (g_sequence_iter_is_end(first)) {
+      break;
+    }
+    Timer* timer = (Timer*)g_sequence_get(first);
+    if (timer->deadline > now) {
+      break;
+    }
+    g_sequence_remove(first);
+    timer->iter = NULL;
+    bool repeats = timer->func(timer->data);
+    if (repeats && !timer->cancelled) {
+      again = g_slist_prepend(again, timer);
+    } else {
+      g_hash_table_remove(wheel->timers, GUINT_TO_POINTER(timer->id));
+    }
+  }
+  for (GSList* li = again; li != NULL; li = li->next) {
+    Timer* timer = (Timer*)li->data;
+    if (timer->cancelled) {
+      // cancelled by a later callback of this dispatch
+      g_hash_table_remove(wheel->timers, GUINT_TO_POINTER(timer->id));
+    } else {
+      timer_schedule(wheel, timer, now);
+    }
+  }
+  g_slist_free(again);
+  timer_wheel_rearm(wheel);
+}
@@ -0,0 +1,114 @@
+/**
+ * timer_test.c
+ *
+ * Copyright (c) 2026 endaaman
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license. See the LICENSE file for details.
+ */
+
+#include "tym_test.h"
+#include "timer.h"
+
+typedef struct {
+  TimerWheel* wheel;
+  unsigned count;
+  unsigned repeat;
+  unsigned remove_id;
+  bool destroyed;
+} Counter;
+
+static bool count_up(void* data)
+{
+  Counter* c = (Counter*)data;
+  c->count += 1;
+  if (c->remove_id) {
+    timer_remove(c->wheel, c->remove_id, NULL);
+  }
+  return c->count < c->repeat;
+}
+
+static void mark_destroyed(void* data)
+{
+  ((Counter*)data)->destroyed = true;
+}
+
+static void test_dispatch()
+{
+  TimerWheel* wheel = timer_wheel_init(10);
+  Counter a = { .wheel = wheel, .repeat = 3 };
+  Counter b = { .wheel = wheel, .repeat = 1 };
+
+  g_assert_cmpint(timer_wheel_get_next_deadline(wheel), ==, -1);
+  timer_add(wheel, NULL, 0, count_up, &a, mark_destroyed);
+  unsigned id = timer_add(wheel, NULL, 100000, count_up, &b, mark_destroyed);
+
+  // deadlines are put on the slack boundaries
+  gint64 next = timer_wheel_get_next_deadline(wheel);
+  g_assert_cmpint(next % 10000, ==, 0);
+
+  // a zero interval runs once per dispatch
+  gint64 now = g_get_monotonic_time() + 1000000;
+  timer_wheel_dispatch(wheel, now);
+  g_assert_cmpuint(a.count, ==, 1);
+  g_assert_cmpuint(b.count, ==, 0);
+  timer_wheel_dispatch(wheel, now + 10000);
+  timer_wheel_dispatch(wheel, now + 20000);
+  timer_wheel_dispatch(wheel, now + 30000);
+  g_assert_cmpuint(a.count, ==, 3);
+  g_assert(a.destroyed);
+
+  // only the owner can remove
+  g_assert_false(timer_remove(wheel, id, &a));
+  g_assert(timer_remove(wheel, id, NULL));
+  g_assert(b.destroyed);
+  g_assert_false(timer_remove(wheel, id, NULL));
+  g_assert_cmpint(timer_wheel_get_next_deadline(wheel), ==, -1);
+
+  timer_wheel_close(wheel);
+}
+
+static void test_remove()
+{
+  TimerWheel* wheel = timer_wheel_init(0);
+  int owner = 0;
+  Counter a = { .wheel = wheel, .repeat = 100 };
+  Counter b = { .wheel = wheel, .repeat = 100 };
+  Counter c = { .wheel = wheel, .repeat = 100 };
+
+  // a timer removes another one which is due in the same dispatch
+  timer_add(wheel, NULL, 0, count_up, &a, mark_destroyed);
+  a.remove_id = timer_add(wheel, NULL, 0, count_up, &b, mark_destroyed);
+  timer_wheel_dispatch(wheel, g_get_monotonic_time() + 1000);
+  g_assert_cmpuint(a.count, ==, 1);
+  g_assert_cmpuint(b.count, ==, 0);
+  g_assert(b.destroyed);
+  a.remove_id = 0;
+
+  // a timer removes itself
+  unsigned id_c = timer_add(wheel, &owner, 0, count_up, &c, mark_destroyed);
+  c.remove_id = id_c;
+  timer_wheel_dispatch(wheel, g_get_monotonic_time() + 1000);
+  g_assert_cmpuint(c.count, ==, 1);
+  g_assert(c.destroyed);
+  g_assert_false(timer_remove(wheel, id_c, &owner));
+
+  // by owner
+  Counter d = { .wheel = wheel, .repeat = 100 };
+  Counter e = { .wheel = wheel, .repeat = 100 };
+  timer_add(wheel, &owner, 1000, count_up, &d, mark_destroyed);
+  timer_add(wheel, &owner, 2000, count_up, &e, mark_destroyed);
+  timer_remove_by_owner(wheel, &owner);
+  g_assert(d.destroyed);
+  g_assert(e.destroyed);
+  g_assert_false(a.destroyed);
+
+  timer_wheel_close(wheel);
+  g_assert(a.destroyed);
+}
+
+void test_timer()
+{
+  test_dispatch();
+  test_remove();
+}
@@ -0,0 +1,200 @@
+/**
+ * trigger.c
+ *
+ * Copyright (c) 2026 endaaman
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license. See the LICENSE file for details.
+ */
+
+#include "trigger.h"
+
+
+// All the patterns are joined into one alternation `(p0)|(p1)|...`, compiled
+// once and JIT'd, so a chunk of output is scanned in a single pass however
+// many triggers there are. Which trigger matched is told by the outer group
+// that is set; `group` is its number, counting the groups inside the patterns
+// before it. Hence numbered backreferences in a pattern do not work, while
+// named ones do. At a position where several patterns match, the first one
+// wins.
+
+#define TRIGGER_OPTIONS (PCRE2_UTF | PCRE2_MULTILINE | PCRE2_DUPNAMES)
+
+
+Triggers* triggers_init()
+{
+  Triggers* triggers = g_new0(Triggers, 1);
+  triggers->items = g_array_new(false, false, sizeof(Trigger));
+  return triggers;
+}
+
+static void triggers_free_code(Triggers* triggers)
+{
+  if (triggers->match_data) {
+    pcre2_match_data_free(triggers->match_data);
+    triggers->match_data = NULL;
+  }
+  if (triggers->code) {
+    pcre2_code_free(triggers->code);
+    triggers->code = NULL;
+  }
+}
+
+// The refs are left to the caller.
+void triggers_clear(Triggers* triggers)
+{
+  for (unsigned i = 0; i < triggers->items->len; i++) {
+    g_free(g_array_index(triggers->items, Trigger, i).pattern);
+  }
+  g_array_set_size(triggers->items, 0);
+  triggers_free_code(triggers);
+}
+
+void triggers_close(Triggers* triggers)
+{
+  triggers_clear(triggers);
+  g_array_unref(triggers->items);
+  g_free(triggers);
+}
+
+static pcre2_code* compile(const char* pattern, char** error)
+{
+  int errorcode;
+  PCRE2_SIZE erroroffset;
+  pcre2_code* code = pcre2_compile(
+    (PCRE2_SPTR)pattern,
+    PCRE2_ZERO_TERMINATED,
+    TRIGGER_OPTIONS,
+    &errorcode,
+    &erroroffset,
+    NULL
+  );
+  if (!code) {
+    PCRE2_UCHAR message[256];
+    pcre2_get_error_message(errorcode, message, sizeof(message));
+    *error = g_strdup_printf("%s at offset %d", (char*)message, (int)erroroffset);
+  }
+  return code;
+}
+
+// Returns the error message on an invalid pattern. The trigger is in use
+// after `triggers_build()`.
+char* triggers_add(Triggers* triggers, const char* pattern, TriggerAction action, int ref)
+{
+  char* error = NULL;
+  pcre2_code* code = compile(pattern, &error);
+  if (!code) {
+    return error;
+  }
+  uint32_t count = 0;
+  pcre2_pattern_info(code, PCRE2_INFO_CAPTURECOUNT, &count);
+  pcre2_code_free(code);
+
+  unsigned group = 1;
+  if (triggers->items->len > 0) {
+    Trigger* last = &g_array_index(triggers->items, Trigger, triggers->items->len - 1);
+    group = last->group + 1 + last->captures;
+  }
+  Trigger trigger = {
+    .pattern = g_strdup(pattern),
+    .action = action,
+    .ref = ref,
+    .group = group,
+    .captures = count,
+  };
+  g_array_append_val(triggers->items, trigger);
+  return NULL;
+}
+
+bool triggers_build(Triggers* triggers)
+{
+  triggers_free_code(triggers);
+  if (triggers->items->len == 0) {
+    return true;
+  }
+  GString* joined = g_string_new(NULL);
+  for (unsigned i = 0; i < triggers->items->len; i++) {
+    if (i > 0) {
+      g_string_append_c(joined, '|');
+    }
+    g_string_append_printf(joined, "(%s)", g_array_index(triggers->items, Trigger, i).pattern);
+  }
+  char* error = NULL;
+  triggers->code = compile(joined->str, &error);
+  g_string_free(joined, true);
+  if (!triggers->code) {
+    // e.g. a pattern closing the group around it
+    g_warning("Failed to join the trigger patterns: %s", error);
+    g_free(error);
+    return false;
+  }
+  // the interpreter is used when JIT is not available
+  pcre2_jit_compile(triggers->code, PCRE2_JIT_COMPLETE);
+  triggers->match_data = pcre2_match_data_create_from_pattern(triggers->code, NULL);
+  return true;
+}
+
+unsigned triggers_count(Triggers* triggers)
+{
+  return triggers->code ? triggers->items->len : 0;
+}
+
+static Trigger* find_matched(Triggers* triggers, PCRE2_SIZE* ovector, uint32_t pairs)
+{
+  for (unsigned i = 0; i < triggers->items->len; i++) {
+    Trigger* trigger = &g_array_index(triggers->items, Trigger, i);
+    if (trigger->group < pairs && ovector[trigger->group * 2] != PCRE2_UNSET) {
+      return trigger;
+    }
+  }
+  return NULL;
+}
+
+// Calls `func` for every match in `text` with the line it is on, and returns
+// how many there were.
+unsigned triggers_scan(Triggers* triggers, const char* text, size_t length, TriggerFunc func, void* user_data)
+{
+  if (!triggers->code) {
+    return 0;
+  }
+  // checked once here instead of by every pcre2_match()
+  if (!g_utf8_validate(text, length, NULL)) {
+    return 0;
+  }
+  unsigned count = 0;
+  PCRE2_SIZE offset = 0;
+  triggers->scanning = true;
+  while (offset <= length) {
+    int res = pcre2_match(triggers->code, (PCRE2_SPTR)text, length, offset, PCRE2_NO_UTF_CHECK, triggers->match_data, NULL);
+    if (res <= 0) {
+      break;
+    }
+    PCRE2_SIZE* ovector = pcre2_get_ovector_pointer(triggers->match_data);
+    PCRE2_SIZE start = ovector[0];
+    PCRE2_SIZE end = ovector[1];
+    Trigger* trigger = find_matched(triggers, ovector, pcre2_get_ovector_count(triggers->match_data));
+    if (trigger) {
+      const char* head = text + start;
+      while (head > text && head[-1] != '\n') {
+        head--;
+      }
+      const char* tail = memchr(text + start, '\n', length - start);
+      if (!tail) {
+        tail = text + length;
+      }
+      func(trigger, head, tail - head, start - (head - text), end - (head - text), user_data);
+      count += 1;
+    }
+    if (end > start) {
+      offset = end;
+    } else {
+      // an empty match
+      if (end >= length) {
+        break;
+      }
+      offset = g_utf8_next_char(text + end) - text;
+    }
+  }
+  triggers->scanning = false;
+  return count;
+}
@@ -0,0 +1,70 @@
+/**
+ * trigger_test.c
+ *
+ * Copyright (c) 2026 endaaman
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license. See the LICENSE file for details.
+ */
+
+#include "tym_test.h"
+#include "trigger.h"
+
+typedef struct {
+  GString* log;
+} Recorder;
+
+static void record(Trigger* trigger, const char* line, size_t length, size_t start, size_t end, void* user_data)
+{
+  GString* log = ((Recorder*)user_data)->log;
+  g_string_append_printf(log, "%d:%.*s:%.*s;", trigger->ref, (int)length, line, (int)(end - start), line + start);
+}
+
+static void test_scan()
+{
+  Triggers* t = triggers_init();
+  g_assert_null(triggers_add(t, "ERROR", TRIGGER_ACTION_FUNCTION, 0));
+  // the groups inside a pattern shift the ones after it
+  g_assert_null(triggers_add(t, "(warn|WARN)(ing)?", TRIGGER_ACTION_FUNCTION, 1));
+  g_assert_null(triggers_add(t, "^done$", TRIGGER_ACTION_FUNCTION, 2));
+  g_assert(triggers_build(t));
+  g_assert_cmpuint(triggers_count(t), ==, 3);
+
+  const char* text = "ok\nan ERROR and a warning\ndone\nnot done\n";
+  Recorder r = { g_string_new(NULL) };
+  g_assert_cmpuint(triggers_scan(t, text, strlen(text), record, &r), ==, 3);
+  g_assert_cmpstr(r.log->str, ==,
+    "0:an ERROR and a warning:ERROR;"
+    "1:an ERROR and a warning:warning;"
+    "2:done:done;");
+
+  // the same name in two patterns
+  triggers_clear(t);
+  g_assert_null(triggers_add(t, "(?<x>a)", TRIGGER_ACTION_NOTIFY, 0));
+  g_assert_null(triggers_add(t, "(?<x>b)\\k<x>", TRIGGER_ACTION_BELL, 1));
+  g_assert(triggers_build(t));
+  g_string_truncate(r.log, 0);
+  g_assert_cmpuint(triggers_scan(t, "bb", 2, record, &r), ==, 1);
+  g_assert_cmpstr(r.log->str, ==, "1:bb:bb;");
+
+  g_string_free(r.log, true);
+  triggers_close(t);
+}
+
+static void test_invalid()
+{
+  Triggers* t = triggers_init();
+  char* error = triggers_add(t, "(unclosed", TRIGGER_ACTION_BELL, 0);
+  g_assert_nonnull(error);
+  g_free(error);
+  g_assert(triggers_build(t));
+  g_assert_cmpuint(triggers_count(t), ==, 0);
+  g_assert_cmpuint(triggers_scan(t, "unclosed", 8, NULL, NULL), ==, 0);
+  triggers_close(t);
+}
+
+void test_trigger()
+{
+  test_scan();
+  test_invalid();
+}
@@ -27,6 +27,13 @@ int main(int argc, char* argv[])
     return 0;
   }
 
+  if (option_get_str(option, "signal") || option_get_str(option, "call")) {
+    int exit_code = app_perform_remote(option);
+    option_close(option);
+    app_close();
+    return exit_code;
+  }
+
   int exit_code = app_start(option, argc, argv);
   app_close();
   return exit_code;
@@ -0,0 +1,138 @@
+/**
+ * tym_ffi.c
+ *
+ * Copyright (c) 2026 endaaman
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license. See the LICENSE file for details.
+ */
+
+#include "tym_ffi.h"
+#include "app.h"
+
+
+// With LuaJIT, `tym.ffi` calls these through the FFI. Unlike the builtins,
+// such calls are compiled into the traces of the caller, so a hook running
+// hot stays on trace. Only numbers, booleans and strings passed in go across,
+// which LuaJIT converts without allocating, and none of these call back into
+// Lua, which is not allowed from a function called through the FFI.
+
+static bool is_of_type(const char* key, MetaEntryType type)
+{
+  MetaEntry* e = meta_get_entry(app->meta, key);
+  return e && e->type == type;
+}
+
+int tym_ffi_get_int(Context* context, const char* key)
+{
+  if (!is_of_type(key, META_ENTRY_TYPE_INTEGER)) {
+    return 0;
+  }
+  return context_get_int(context, key);
+}
+
+bool tym_ffi_set_int(Context* context, const char* key, int value)
+{
+  if (!is_of_type(key, META_ENTRY_TYPE_INTEGER)) {
+    return false;
+  }
+  context_set_int(context, key, value);
+  return true;
+}
+
+bool tym_ffi_get_bool(Context* context, const char* key)
+{
+  if (!is_of_type(key, META_ENTRY_TYPE_BOOLEAN)) {
+    return false;
+  }
+  return context_get_bool(context, key);
+}
+
+bool tym_ffi_set_bool(Context* context, const char* key, bool value)
+{
+  if (!is_of_type(key, META_ENTRY_TYPE_BOOLEAN)) {
+    return false;
+  }
+  context_set_bool(context, key, value);
+  return true;
+}
+
+int tym_ffi_get_cursor_column(Context* context)
+{
+  long column = 0;
+  vte_terminal_get_cursor_position(context->layout.vte, &column, NULL);
+  return column;
+}
+
+int tym_ffi_get_cursor_row(Context* context)
+{
+  long row = 0;
+  vte_terminal_get_cursor_position(context->layout.vte, NULL, &row);
+  return row;
+}
+
+bool tym_ffi_has_selection(Context* context)
+{
+  return vte_terminal_get_has_selection(context->layout.vte);
+}
+
+void tym_ffi_put(Context* context, const char* text, size_t length)
+{
+  if (length > TYM_PASTE_CHUNK_SIZE || paste_is_active(context->paste)) {
+    paste_append(context->paste, text, false);
+  } else {
+    vte_terminal_feed_child(context->layout.vte, text, length);
+  }
+}
+
+#if USES_LUAJIT
+// `int` rather than `long` is returned, since a 64-bit integer comes back
+// to Lua boxed in a cdata.
+static const char* FFI_CHUNK =
+  "local ffi = require('ffi')\n"
+  "-- pcall() as declaring twice in one state raises\n"
+  "pcall(ffi.cdef, [[\n"
+  "  typedef struct TymContext TymContext;\n"
+  "  int tym_ffi_get_int(TymContext* context, const char* key);\n"
+  "  bool tym_ffi_set_int(TymContext* context, const char* key, int value);\n"
+  "  bool tym_ffi_get_bool(TymContext* context, const char* key);\n"
+  "  bool tym_ffi_set_bool(TymContext* context, const char* key, bool value);\n"
+  "  int tym_ffi_get_cursor_column(TymContext* context);\n"
+  "  int tym_ffi_get_cursor_row(TymContext* context);\n"
+  "  bool tym_ffi_has_selection(TymContext* context);\n"
+  "  void tym_ffi_put(TymContext* context, const char* text, size_t length);\n"
+  "]])\n"
+  "local C = ffi.C\n"
+  "local _ = C.tym_ffi_put -- raises unless the functions are exported\n"
+  "local context = ffi.cast('TymContext*', ...)\n"
+  "return {\n"
+  "  get_int = function(key) return C.tym_ffi_get_int(context, key) end,\n"
+  "  set_int = function(key, value) return C.tym_ffi_set_int(context, key, value) end,\n"
+  "  get_bool = function(key) return C.tym_ffi_get_bool(context, key) end,\n"
+  "  set_bool = function(key, value) return C.tym_ffi_set_bool(context, key, value) end,\n"
+  "  get_cursor_position = function()\n"
+  "    return C.tym_ffi_get_cursor_column(context), C.tym_ffi_get_cursor_row(context)\n"
+  "  end,\n"
+  "  has_selection = function() return C.tym_ffi_has_selection(context) end,\n"
+  "  put = function(text) C.tym_ffi_put(context, text, #text) end,\n"
+  "}\n";
+#endif
+
+// Sets `ffi` of the module table on the top of the stack. Without LuaJIT,
+// or when the FFI can not find the functions, it is left nil.
+void tym_ffi_register(lua_State* L, Context* context)
+{
+#if USES_LUAJIT
+  if (luaL_loadbuffer(L, FFI_CHUNK, strlen(FFI_CHUNK), "=tym.ffi") != LUA_OK) {
+    lua_pop(L, 1);
+    return;
+  }
+  lua_pushlightuserdata(L, context);
+  if (lua_pcall(L, 1, 1, 0) != LUA_OK) {
+    dd("tym.ffi is not available: %s", lua_tostring(L, -1));
+    lua_pop(L, 1);
+    return;
+  }
+  lua_setfield(L, -2, "ffi");
+#endif
+}
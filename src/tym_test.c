@@ -14,7 +14,16 @@ int main(int argc, char* argv[])
 {
   g_test_init(&argc, &argv, NULL);
   g_test_add_func("/tym/config", test_config);
+  g_test_add_func("/tym/context", test_context);
+  g_test_add_func("/tym/keymap", test_keymap);
+  g_test_add_func("/tym/macro", test_macro);
   g_test_add_func("/tym/regex", test_regex);
   g_test_add_func("/tym/option", test_option);
+  g_test_add_func("/tym/registry", test_registry);
+  g_test_add_func("/tym/screen", test_screen);
+  g_test_add_func("/tym/stats", test_stats);
+  g_test_add_func("/tym/timer", test_timer);
+  g_test_add_func("/tym/trigger", test_trigger);
+  g_test_add_func("/tym/variant", test_variant);
   return g_test_run();
 }
@@ -0,0 +1,360 @@
+/**
+ * variant.c
+ *
+ * Copyright (c) 2026 endaaman
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license. See the LICENSE file for details.
+ */
+
+#include "variant.h"
+
+
+// Lua values are converted as follows, and back the other way round.
+//
+//   boolean              b
+//   integer              x      (float with no fraction too on Lua 5.1)
+//   number               d
+//   string               s      (ay unless it is valid UTF-8 without NUL)
+//   sequence             a<T>   (av unless all the items are of one type)
+//   other table          a{s<T>} or a{x<T>} (<T> is v unless uniform)
+//
+// Integers of any width, object paths and signatures, variants and maybe
+// types are accepted from the other side as well.
+
+#define VARIANT_MAX_DEPTH 32
+
+static GVariant* from_lua(lua_State* L, int index, int depth, const char** error);
+
+static size_t raw_len(lua_State* L, int index)
+{
+#if USES_LUAJIT
+  return lua_objlen(L, index);
+#else
+  return lua_rawlen(L, index);
+#endif
+}
+
+static GVariant* number_from_lua(lua_State* L, int index)
+{
+#if LUA_VERSION_NUM >= 503
+  if (lua_isinteger(L, index)) {
+    return g_variant_new_int64(lua_tointeger(L, index));
+  }
+  return g_variant_new_double(lua_tonumber(L, index));
+#else
+  lua_Number n = lua_tonumber(L, index);
+  // within the range a double holds every integer exactly
+  if (n >= -9007199254740992.0 && n <= 9007199254740992.0) {
+    // ordered comparisons instead of `== 0` keep -Wfloat-equal quiet
+    lua_Number fraction = n - (lua_Number)(gint64)n;
+    if (!(fraction < 0 || fraction > 0)) {
+      return g_variant_new_int64((gint64)n);
+    }
+  }
+  return g_variant_new_double(n);
+#endif
+}
+
+static GVariant* string_from_lua(lua_State* L, int index)
+{
+  size_t len = 0;
+  const char* s = lua_tolstring(L, index, &len);
+  if (g_utf8_validate(s, len, NULL)) {
+    return g_variant_new_string(s);
+  }
+  return g_variant_new_fixed_array(G_VARIANT_TYPE_BYTE, s, len, 1);
+}
+
+// Whether all the children are of one type. If so, `type` is set to it.
+static bool is_uniform(GPtrArray* children, const GVariantType** type)
+{
+  *type = NULL;
+  for (unsigned i = 0; i < children->len; i++) {
+    const GVariantType* t = g_variant_get_type(g_ptr_array_index(children, i));
+    if (*type && !g_variant_type_equal(*type, t)) {
+      return false;
+    }
+    *type = t;
+  }
+  return *type != NULL;
+}
+
+// The children are non-floating refs owned by the array.
+static GPtrArray* new_children()
+{
+  return g_ptr_array_new_with_free_func((GDestroyNotify)g_variant_unref);
+}
+
+static GVariant* sequence_from_lua(lua_State* L, int index, size_t len, int depth, const char** error)
+{
+  GPtrArray* children = new_children();
+  for (size_t i = 1; i <= len; i++) {
+    lua_rawgeti(L, index, i);
+    GVariant* v = from_lua(L, lua_gettop(L), depth + 1, error);
+    lua_pop(L, 1);
+    if (!v) {
+      g_ptr_array_free(children, true);
+      return NULL;
+    }
+    g_ptr_array_add(children, g_variant_ref_sink(v));
+  }
+  const GVariantType* type = NULL;
+  GVariant* result = NULL;
+  if (is_uniform(children, &type)) {
+    result = g_variant_new_array(type, (GVariant**)children->pdata, children->len);
+  } else {
+    GVariantBuilder builder;
+    g_variant_builder_init(&builder, G_VARIANT_TYPE("av"));
+    for (unsigned i = 0; i < children->len; i++) {
+      g_variant_builder_add(&builder, "v", g_ptr_array_index(children, i));
+    }
+    result = g_variant_builder_end(&builder);
+  }
+  g_ptr_array_free(children, true);
+  return result;
+}
+
+static GVariant* dict_from_lua(lua_State* L, int index, int depth, const char** error)
+{
+  GPtrArray* keys = new_children();
+  GPtrArray* values = new_children();
+  GVariant* result = NULL;
+  lua_pushnil(L);
+  while (lua_next(L, index)) {
+    GVariant* k = NULL;
+    int key_type = lua_type(L, -2);
+    if (key_type == LUA_TSTRING) {
+      k = g_variant_new_string(lua_tostring(L, -2));
+    } else if (key_type == LUA_TNUMBER) {
+      // a copy, since converting the key itself would confuse lua_next()
+      lua_pushvalue(L, -2);
+      k = number_from_lua(L, lua_gettop(L));
+      lua_pop(L, 1);
+    } else {
+      *error = "table keys must be strings or numbers";
+      lua_pop(L, 2); // value, key
+      goto EXIT;
+    }
+    g_ptr_array_add(keys, g_variant_ref_sink(k));
+    GVariant* v = from_lua(L, lua_gettop(L), depth + 1, error);
+    lua_pop(L, 1); // value
+    if (!v) {
+      lua_pop(L, 1); // key
+      goto EXIT;
+    }
+    g_ptr_array_add(values, g_variant_ref_sink(v));
+  }
+
+  const GVariantType* key_type = NULL;
+  if (keys->len == 0) {
+    result = g_variant_new_array(G_VARIANT_TYPE("{sv}"), NULL, 0);
+    goto EXIT;
+  }
+  if (!is_uniform(keys, &key_type)) {
+    *error = "table keys must be all strings or all integers";
+    goto EXIT;
+  }
+  const GVariantType* value_type = NULL;
+  bool boxed = !is_uniform(values, &value_type);
+  GVariantType* entry_type = g_variant_type_new_dict_entry(key_type, boxed ? G_VARIANT_TYPE_VARIANT : value_type);
+  GVariantType* dict_type = g_variant_type_new_array(entry_type);
+  GVariantBuilder builder;
+  g_variant_builder_init(&builder, dict_type);
+  for (unsigned i = 0; i < keys->len; i++) {
+    GVariant* v = g_ptr_array_index(values, i);
+    g_variant_builder_add_value(&builder, g_variant_new_dict_entry(
+      g_ptr_array_index(keys, i),
+      boxed ? g_variant_new_variant(v) : v));
+  }
+  result = g_variant_builder_end(&builder);
+  g_variant_type_free(dict_type);
+  g_variant_type_free(entry_type);
+
+EXIT:
+  g_ptr_array_free(keys, true);
+  g_ptr_array_free(values, true);
+  return result;
+}
+
+static GVariant* table_from_lua(lua_State* L, int index, int depth, const char** error)
+{
+  if (depth >= VARIANT_MAX_DEPTH || !lua_checkstack(L, 4)) {
+    *error = "tables are nested too deep";
+    return NULL;
+  }
+  size_t len = raw_len(L, index);
+  size_t count = 0;
+  lua_pushnil(L);
+  while (lua_next(L, index)) {
+    count += 1;
+    lua_pop(L, 1);
+  }
+  if (len > 0 && count == len) {
+    return sequence_from_lua(L, index, len, depth, error);
+  }
+  return dict_from_lua(L, index, depth, error);
+}
+
+static GVariant* from_lua(lua_State* L, int index, int depth, const char** error)
+{
+  switch (lua_type(L, index)) {
+    case LUA_TBOOLEAN:
+      return g_variant_new_boolean(lua_toboolean(L, index));
+    case LUA_TNUMBER:
+      return number_from_lua(L, index);
+    case LUA_TSTRING:
+      return string_from_lua(L, index);
+    case LUA_TTABLE:
+      return table_from_lua(L, index, depth, error);
+    default:
+      *error = "only booleans, numbers, strings and tables can be converted";
+      return NULL;
+  }
+}
+
+// Returns a floating reference, or NULL with `error` set.
+GVariant* variant_from_lua(lua_State* L, int index, const char** error)
+{
+  if (index < 0) {
+    index = lua_gettop(L) + index + 1;
+  }
+  return from_lua(L, index, 0, error);
+}
+
+// A tuple of the items of the sequence at `index`, as the parameters of D-Bus.
+GVariant* variant_tuple_from_lua(lua_State* L, int index, const char** error)
+{
+  if (index < 0) {
+    index = lua_gettop(L) + index + 1;
+  }
+  size_t len = raw_len(L, index);
+  GPtrArray* children = new_children();
+  for (size_t i = 1; i <= len; i++) {
+    lua_rawgeti(L, index, i);
+    GVariant* v = from_lua(L, lua_gettop(L), 1, error);
+    lua_pop(L, 1);
+    if (!v) {
+      g_ptr_array_free(children, true);
+      return NULL;
+    }
+    g_ptr_array_add(children, g_variant_ref_sink(v));
+  }
+  GVariant* result = g_variant_new_tuple((GVariant**)children->pdata, children->len);
+  g_ptr_array_free(children, true);
+  return result;
+}
+
+void variant_push(lua_State* L, GVariant* v)
+{
+  luaL_checkstack(L, 4, "nested too deep");
+  switch (g_variant_classify(v)) {
+    case G_VARIANT_CLASS_BOOLEAN:
+      lua_pushboolean(L, g_variant_get_boolean(v));
+      return;
+    case G_VARIANT_CLASS_BYTE:
+      lua_pushinteger(L, g_variant_get_byte(v));
+      return;
+    case G_VARIANT_CLASS_INT16:
+      lua_pushinteger(L, g_variant_get_int16(v));
+      return;
+    case G_VARIANT_CLASS_UINT16:
+      lua_pushinteger(L, g_variant_get_uint16(v));
+      return;
+    case G_VARIANT_CLASS_INT32:
+      lua_pushinteger(L, g_variant_get_int32(v));
+      return;
+    case G_VARIANT_CLASS_UINT32:
+      lua_pushinteger(L, g_variant_get_uint32(v));
+      return;
+    case G_VARIANT_CLASS_HANDLE:
+      lua_pushinteger(L, g_variant_get_handle(v));
+      return;
+    case G_VARIANT_CLASS_INT64:
+      lua_pushinteger(L, g_variant_get_int64(v));
+      return;
+    case G_VARIANT_CLASS_UINT64:
+      lua_pushinteger(L, g_variant_get_uint64(v));
+      return;
+    case G_VARIANT_CLASS_DOUBLE:
+      lua_pushnumber(L, g_variant_get_double(v));
+      return;
+    case G_VARIANT_CLASS_STRING:
+    case G_VARIANT_CLASS_OBJECT_PATH:
+    case G_VARIANT_CLASS_SIGNATURE:
+      lua_pushstring(L, g_variant_get_string(v, NULL));
+      return;
+    case G_VARIANT_CLASS_VARIANT: {
+      GVariant* inner = g_variant_get_variant(v);
+      variant_push(L, inner);
+      g_variant_unref(inner);
+      return;
+    }
+    case G_VARIANT_CLASS_MAYBE: {
+      GVariant* inner = g_variant_get_maybe(v);
+      if (inner) {
+        variant_push(L, inner);
+        g_variant_unref(inner);
+      } else {
+        lua_pushnil(L);
+      }
+      return;
+    }
+    case G_VARIANT_CLASS_ARRAY:
+      if (g_variant_is_of_type(v, G_VARIANT_TYPE_BYTESTRING)) {
+        size_t len = 0;
+        const char* bytes = g_variant_get_fixed_array(v, &len, 1);
+        lua_pushlstring(L, bytes, len);
+        return;
+      }
+      if (g_variant_type_is_dict_entry(g_variant_type_element(g_variant_get_type(v)))) {
+        lua_newtable(L);
+        GVariantIter iter;
+        GVariant* entry = NULL;
+        g_variant_iter_init(&iter, v);
+        while ((entry = g_variant_iter_next_value(&iter))) {
+          GVariant* key = g_variant_get_child_value(entry, 0);
+          GVariant* value = g_variant_get_child_value(entry, 1);
+          variant_push(L, key);
+          variant_push(L, value);
+          lua_rawset(L, -3);
+          g_variant_unref(key);
+          g_variant_unref(value);
+          g_variant_unref(entry);
+        }
+        return;
+      }
+      // fall through
+    case G_VARIANT_CLASS_TUPLE:
+    case G_VARIANT_CLASS_DICT_ENTRY: {
+      lua_newtable(L);
+      size_t num = g_variant_n_children(v);
+      for (size_t i = 0; i < num; i++) {
+        GVariant* e = g_variant_get_child_value(v, i);
+        variant_push(L, e);
+        lua_rawseti(L, -2, i + 1);
+        g_variant_unref(e);
+      }
+      return;
+    }
+    default: {
+      char* s = g_variant_print(v, false);
+      lua_pushstring(L, s);
+      g_free(s);
+      return;
+    }
+  }
+}
+
+// Pushes the children of a tuple one by one, and returns how many.
+int variant_push_children(lua_State* L, GVariant* v)
+{
+  int num = g_variant_n_children(v);
+  luaL_checkstack(L, num, "too many values");
+  for (int i = 0; i < num; i++) {
+    GVariant* e = g_variant_get_child_value(v, i);
+    variant_push(L, e);
+    g_variant_unref(e);
+  }
+  return num;
+}
@@ -0,0 +1,102 @@
+/**
+ * variant_test.c
+ *
+ * Copyright (c) 2026 endaaman
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license. See the LICENSE file for details.
+ */
+
+#include "tym_test.h"
+#include "variant.h"
+
+// Converts the value the chunk returns.
+static GVariant* convert(lua_State* L, const char* chunk, const char** error)
+{
+  g_assert_cmpint(luaL_loadstring(L, chunk), ==, LUA_OK);
+  g_assert_cmpint(lua_pcall(L, 0, 1, 0), ==, LUA_OK);
+  GVariant* v = variant_from_lua(L, -1, error);
+  lua_pop(L, 1);
+  if (v) {
+    g_variant_ref_sink(v);
+  }
+  return v;
+}
+
+static void assert_converted(lua_State* L, const char* chunk, const char* expected)
+{
+  const char* error = NULL;
+  GVariant* v = convert(L, chunk, &error);
+  g_assert_nonnull(v);
+  char* printed = g_variant_print(v, true);
+  g_assert_cmpstr(printed, ==, expected);
+  g_free(printed);
+  g_variant_unref(v);
+}
+
+static void test_from_lua()
+{
+  lua_State* L = luaL_newstate();
+  assert_converted(L, "return true", "true");
+  assert_converted(L, "return 42", "int64 42");
+  assert_converted(L, "return 0.5", "0.5");
+  assert_converted(L, "return 'abc'", "'abc'");
+  assert_converted(L, "return {1, 2, 3}", "[int64 1, 2, 3]");
+  assert_converted(L, "return {1, 'a'}", "[<int64 1>, <'a'>]");
+  assert_converted(L, "return {}", "@a{sv} {}");
+  assert_converted(L, "return {a = 'x'}", "{'a': 'x'}");
+  assert_converted(L, "return {a = {b = true}}", "{'a': {'b': true}}");
+
+  // not valid UTF-8
+  const char* error = NULL;
+  GVariant* bytes = convert(L, "return 'a\\0b\\255'", &error);
+  g_assert_cmpstr(g_variant_get_type_string(bytes), ==, "ay");
+  g_assert_cmpuint(g_variant_n_children(bytes), ==, 4);
+  g_variant_unref(bytes);
+
+  g_assert_null(convert(L, "return print", &error));
+  g_assert_nonnull(error);
+  g_assert_null(convert(L, "return {a = 1, [true] = 2}", &error));
+  g_assert_null(convert(L, "return {a = 1, [2] = 2}", &error));
+  g_assert_null(convert(L, "local t = {} t[1] = t return t", &error));
+
+  lua_newtable(L);
+  lua_pushstring(L, "eval");
+  lua_rawseti(L, -2, 1);
+  lua_pushinteger(L, 3);
+  lua_rawseti(L, -2, 2);
+  GVariant* tuple = g_variant_ref_sink(variant_tuple_from_lua(L, -1, &error));
+  lua_pop(L, 1);
+  g_assert_cmpstr(g_variant_get_type_string(tuple), ==, "(sx)");
+  g_variant_unref(tuple);
+
+  g_assert_cmpint(lua_gettop(L), ==, 0);
+  lua_close(L);
+}
+
+static void test_push()
+{
+  lua_State* L = luaL_newstate();
+  GVariant* v = g_variant_ref_sink(g_variant_new_parsed(
+    "(true, uint64 7, 1.5, 'x', <int16 -2>, @ms nothing, [byte 0x61, 0x62], {'k': [1, 2]})"));
+  int num = variant_push_children(L, v);
+  g_variant_unref(v);
+  g_assert_cmpint(num, ==, 8);
+  g_assert(lua_toboolean(L, 1));
+  g_assert_cmpint(lua_tointeger(L, 2), ==, 7);
+  g_assert_cmpfloat(lua_tonumber(L, 3), ==, 1.5);
+  g_assert_cmpstr(lua_tostring(L, 4), ==, "x");
+  g_assert_cmpint(lua_tointeger(L, 5), ==, -2);
+  g_assert(lua_isnil(L, 6));
+  g_assert_cmpstr(lua_tostring(L, 7), ==, "ab");
+  lua_getfield(L, 8, "k");
+  lua_rawgeti(L, -1, 2);
+  g_assert_cmpint(lua_tointeger(L, -1), ==, 2);
+  lua_close(L);
+}
+
+void test_variant()
+{
+  test_from_lua();
+  test_push();
+}